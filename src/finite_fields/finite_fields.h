@@ -1,15 +1,64 @@
 #pragma once
 
 #include <iostream>
+#include <cstdint>
+#include <type_traits>
+#include <cstddef>
+#include <vector>
 
-template <unsigned int n>
+// Primes up to this size get a compile time generated table of inverses.
+#define FF_INVERSE_TABLE_MAX_SIZE 4096
+
+/*
+ * Table of the inverses of all elements of GF(n), generated at compile time
+ * using inv(i) = -(n/i) * inv(n mod i) which only needs inverses of smaller
+ * elements.
+ */
+template <uint64_t n>
+struct FFInverseTable {
+  constexpr FFInverseTable() : inv_() {
+    inv_[1] = 1;
+    for(unsigned int i = 2; i < n; i++) {
+      inv_[i] = n - (n/i) * inv_[n%i] % n;
+    }
+  }
+
+  unsigned int inv_[n];
+};
+
+/*
+ * Word types used by FFElem<n>. Elements of fields with n below 2^31 are
+ * stored on 32 bits (the sum of two elements still fits), larger primes (up
+ * to 2^63) on 64 bits. Products are computed in a word twice as large so that
+ * they never overflow.
+ */
+template <uint64_t n, bool small = (n < (1ull << 31))>
+struct FFWord {
+  typedef uint32_t type;
+  typedef uint64_t wide;
+};
+
+template <uint64_t n>
+struct FFWord<n, false> {
+  typedef uint64_t type;
+  typedef unsigned __int128 wide;
+};
+
+template <uint64_t n>
 class FFElem {
+  static_assert(n < (1ull << 63), "FFElem requires a modulus below 2^63");
+
   public:
-    static const unsigned int characteristic;
+    typedef typename FFWord<n>::type word;
+    typedef typename FFWord<n>::wide wide;
+
+    static const uint64_t characteristic;
 
     FFElem<n>();
     FFElem<n>(unsigned int v);
     FFElem<n>(int v);
+    FFElem<n>(uint64_t v);
+    FFElem<n>(int64_t v);
 
     void operator+=(const FFElem<n> &other);
     void operator-=(const FFElem<n> &other);
@@ -19,66 +68,82 @@ class FFElem {
     int compare(const FFElem<n> &other) const;
     void toStream(std::ostream &s) const;
     FFElem<n> inverse() const;
+    word value() const;
 
   protected:
     void normalize();
+    FFElem<n> inverse(std::true_type useTable) const;
+    FFElem<n> inverse(std::false_type useTable) const;
 
-		unsigned int val_;
+		word val_;
 };
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n>::FFElem() : val_(0) {};
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n>::FFElem(unsigned int v) : val_(v) {
   normalize();
 };
 
-template <unsigned int n>
-FFElem<n>::FFElem(int v) {
-  if(v < 0) { 
-    v += (-v/n + 1)*n; 
-  } 
-  val_ = v; 
-  normalize();
+template <uint64_t n>
+FFElem<n>::FFElem(int v) : FFElem<n>(static_cast<int64_t>(v)) {};
+
+template <uint64_t n>
+FFElem<n>::FFElem(uint64_t v) : val_(v % n) {};
+
+template <uint64_t n>
+FFElem<n>::FFElem(int64_t v) {
+  int64_t r = v % static_cast<int64_t>(n);
+  if(r < 0) {
+    r += n;
+  }
+  val_ = r;
 };
 
-template <unsigned int n>
-const unsigned int FFElem<n>::characteristic = n;
+template <uint64_t n>
+const uint64_t FFElem<n>::characteristic = n;
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::normalize() {
   if(this->val_ >= n) {
     this->val_ = this->val_ % n;
   }
 };
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::operator+=(const FFElem<n> &other) {
   val_ += other.val_;
-  normalize();
+  if(val_ >= n) {
+    val_ -= n;
+  }
 }
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::operator-=(const FFElem<n> &other) {
-  while(other.val_ > val_) { val_ += n; }
+  if(other.val_ > val_) {
+    val_ += n;
+  }
   val_ -= other.val_;
-  normalize();
 }
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::operator*=(const FFElem<n> &other) {
-  val_ *= other.val_;
-  normalize();
+  val_ = static_cast<wide>(val_) * other.val_ % n;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::operator/=(const FFElem<n> &other) {
   operator*=(other.inverse());
   normalize();
 }
 
-template <unsigned int n>
+template <uint64_t n>
+typename FFElem<n>::word FFElem<n>::value() const {
+  return val_;
+}
+
+template <uint64_t n>
 int FFElem<n>::compare(const FFElem<n> &other) const {
   if(val_ < other.val_) {
     return -1;
@@ -88,90 +153,134 @@ int FFElem<n>::compare(const FFElem<n> &other) const {
   return 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator<(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) < 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator<=(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) <= 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator>(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) > 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator>=(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) >= 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator==(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) == 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 bool operator!=(const FFElem<n> &a, const FFElem<n> &b) {
   return a.compare(b) != 0;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> operator+(const FFElem<n> &a, const FFElem<n> &b) {
   auto r = a;
   r += b;
   return r;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> operator-(const FFElem<n> &a) {
   FFElem<n> r(0);
   r -= a;
   return r;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> operator-(const FFElem<n> &a, const FFElem<n> &b) {
   auto r = a;
   r -= b;
   return r;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> operator*(const FFElem<n> &a, const FFElem<n> &b) {
   auto r = a;
   r *= b;
   return r;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> operator/(const FFElem<n> &a, const FFElem<n> &b) {
   auto r = a;
   r /= b;
   return r;
 }
 
-template <unsigned int n>
+template <uint64_t n>
 FFElem<n> FFElem<n>::inverse() const {
-  FFElem<n> self(*this);
-  for(unsigned int i = 0; i < n; i++) {
-    FFElem<n> inv(i);
-    FFElem<n> unit(1);
-    if(inv*self == unit) {
-      return inv;
+  return inverse(std::integral_constant<bool, n <= FF_INVERSE_TABLE_MAX_SIZE>());
+}
+
+template <uint64_t n>
+FFElem<n> FFElem<n>::inverse(std::true_type) const {
+  static constexpr FFInverseTable<n> table{};
+  return FFElem<n>(table.inv_[val_]);
+}
+
+/* Extended Euclid algorithm, returns 0 as the inverse of 0 */
+template <uint64_t n>
+FFElem<n> FFElem<n>::inverse(std::false_type) const {
+  int64_t t = 0, newt = 1;
+  int64_t r = n, newr = val_;
+  while(newr != 0) {
+    int64_t q = r / newr;
+    int64_t tmp = t - q * newt;
+    t = newt;
+    newt = tmp;
+    tmp = r - q * newr;
+    r = newr;
+    newr = tmp;
+  }
+  if(t < 0) {
+    t += n;
+  }
+  return FFElem<n>(static_cast<uint64_t>(t));
+}
+
+/*
+ * Replaces each element of v by its inverse (0 staying 0) using Montgomery's
+ * trick: a single inversion of the product of all elements and 3 multiplications
+ * per element.
+ */
+template <uint64_t n>
+void batchInverse(FFElem<n> *v, size_t len) {
+  // prefix[i] is the product of the non-zero elements before v[i]
+  std::vector<FFElem<n>> prefix(len);
+  FFElem<n> acc(1);
+  for(size_t i = 0; i < len; i++) {
+    prefix[i] = acc;
+    if(v[i] != FFElem<n>(0)) {
+      acc *= v[i];
+    }
+  }
+  FFElem<n> inv = acc.inverse();
+  for(size_t i = len; i > 0; i--) {
+    if(v[i-1] != FFElem<n>(0)) {
+      FFElem<n> r = inv * prefix[i-1];
+      inv *= v[i-1];
+      v[i-1] = r;
     }
   }
-  return FFElem<n>(0);
 }
 
-template <unsigned int n>
+template <uint64_t n>
 void FFElem<n>::toStream(std::ostream &s) const {
   s << val_ << "[" << n << "]";
 }
 
-template <unsigned int n>
+template <uint64_t n>
 std::ostream &operator<<(std::ostream &s, const FFElem<n> &v) {
   v.toStream(s);
   return s;
@@ -0,0 +1,357 @@
+#pragma once
+
+/*
+ * Elements of the extension field GF(p^k) = GF(p)[a] / f(a), for f a monic
+ * irreducible polynomial of degree k over GF(p).
+ *
+ * Elements store their k coefficients inline (no allocation) and use the
+ * ExtFFContext installed by the innermost live ExtFFContextGuard of the
+ * current thread, which holds f and the precomputed reductions of a^k ...
+ * a^(2k-2). As for DynFFElem, this keeps elements constructible from plain
+ * integers (the prime subfield) so that they can be used as the coefficient
+ * type of Poly<T>. Every thread computing with them needs a guard, the program
+ * aborting otherwise, but the parallel algorithms of Poly<T> give their pool
+ * tasks the context of the thread starting them (see coeffsContext in
+ * polynomial_ff.h).
+ *
+ *   // GF(4) = GF(2)[a] / (a^2 + a + 1)
+ *   auto ctx = std::make_shared<ExtFFContext<2, 2>>(Poly<FFElem<2>>({1, 1, 1}));
+ *   ExtFFContextGuard<2, 2> guard(ctx);
+ *   Poly<ExtFFElem<2, 2>> g({ExtFFElem<2, 2>::generator(), 1});
+ */
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "finite_fields.h"
+#include "../polynomial/polynomial.h"
+
+template <uint64_t p, unsigned int k>
+class ExtFFElem;
+
+template <uint64_t p, unsigned int k>
+class ExtFFContext {
+  friend class ExtFFElem<p, k>;
+
+  public:
+    // The modulus must have degree k
+    ExtFFContext(const Poly<FFElem<p>> &modulus);
+
+    const Poly<FFElem<p>> &modulus() const;
+
+  protected:
+    Poly<FFElem<p>> modulus_;
+    // reduction_[i][j]: coefficient of a^j in a^(k+i) mod f
+    FFElem<p> reduction_[k > 1 ? k-1 : 1][k];
+};
+
+template <uint64_t p, unsigned int k>
+ExtFFContext<p, k>::ExtFFContext(const Poly<FFElem<p>> &modulus) : modulus_(modulus) {
+  modulus_.simplify();
+  assert(modulus_.degree() == static_cast<int>(k));
+  // Make the modulus monic so that a^k = -(f_0 + ... + f_(k-1) a^(k-1))
+  modulus_ = modulus_ / modulus_.coeffs_[modulus_.degree()];
+  auto x = Poly<FFElem<p>>::Xn(k) % modulus_;
+  for(unsigned int i = 0; i + 1 < k; i++) {
+    for(unsigned int j = 0; j < k; j++) {
+      reduction_[i][j] = static_cast<int>(j) <= x.degree() ? x.coeffs_[j] : FFElem<p>(0);
+    }
+    x = (x * Poly<FFElem<p>>::Xn(1)) % modulus_;
+  }
+}
+
+template <uint64_t p, unsigned int k>
+const Poly<FFElem<p>> &ExtFFContext<p, k>::modulus() const {
+  return modulus_;
+}
+
+template <uint64_t p, unsigned int k>
+class ExtFFElem {
+  public:
+    static const uint64_t characteristic;
+
+    ExtFFElem<p, k>();
+    ExtFFElem<p, k>(int v);
+    ExtFFElem<p, k>(const FFElem<p> &v);
+    ExtFFElem<p, k>(const Poly<FFElem<p>> &v);
+
+    // The class of a in GF(p)[a] / f(a)
+    static ExtFFElem<p, k> generator();
+    static const ExtFFContext<p, k> &context();
+
+    void operator+=(const ExtFFElem<p, k> &other);
+    void operator-=(const ExtFFElem<p, k> &other);
+    void operator*=(const ExtFFElem<p, k> &other);
+    void operator/=(const ExtFFElem<p, k> &other);
+
+    int compare(const ExtFFElem<p, k> &other) const;
+    void toStream(std::ostream &s) const;
+    ExtFFElem<p, k> inverse() const;
+    Poly<FFElem<p>> toPoly() const;
+
+  protected:
+    template <uint64_t q, unsigned int l> friend class ExtFFContextGuard;
+    static const ExtFFContext<p, k> *&current();
+
+		FFElem<p> coeffs_[k];
+};
+
+/*
+ * Installs a context for the ExtFFElem<p, k> of the current thread for the
+ * lifetime of the guard, restoring the previous one afterwards.
+ */
+template <uint64_t p, unsigned int k>
+class ExtFFContextGuard {
+  public:
+    ExtFFContextGuard(std::shared_ptr<const ExtFFContext<p, k>> ctx);
+    // Installs a context owned elsewhere, e.g. by the guard of another thread
+    ExtFFContextGuard(const ExtFFContext<p, k> *ctx);
+    ~ExtFFContextGuard();
+
+    // Context of the calling thread, nullptr if there is none
+    static const ExtFFContext<p, k> *installed();
+
+    ExtFFContextGuard(const ExtFFContextGuard &) = delete;
+    ExtFFContextGuard &operator=(const ExtFFContextGuard &) = delete;
+
+  protected:
+    std::shared_ptr<const ExtFFContext<p, k>> ctx_;
+    const ExtFFContext<p, k> *previous_;
+};
+
+template <uint64_t p, unsigned int k>
+ExtFFContextGuard<p, k>::ExtFFContextGuard(std::shared_ptr<const ExtFFContext<p, k>> ctx) : ctx_(ctx) {
+  previous_ = ExtFFElem<p, k>::current();
+  ExtFFElem<p, k>::current() = ctx_.get();
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFContextGuard<p, k>::ExtFFContextGuard(const ExtFFContext<p, k> *ctx) {
+  previous_ = ExtFFElem<p, k>::current();
+  ExtFFElem<p, k>::current() = ctx;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFContextGuard<p, k>::~ExtFFContextGuard() {
+  ExtFFElem<p, k>::current() = previous_;
+}
+
+template <uint64_t p, unsigned int k>
+const ExtFFContext<p, k> *ExtFFContextGuard<p, k>::installed() {
+  return ExtFFElem<p, k>::current();
+}
+
+template <uint64_t p, unsigned int k>
+const uint64_t ExtFFElem<p, k>::characteristic = p;
+
+template <uint64_t p, unsigned int k>
+const ExtFFContext<p, k> *&ExtFFElem<p, k>::current() {
+  thread_local const ExtFFContext<p, k> *ctx = nullptr;
+  return ctx;
+}
+
+template <uint64_t p, unsigned int k>
+const ExtFFContext<p, k> &ExtFFElem<p, k>::context() {
+  const ExtFFContext<p, k> *ctx = current();
+  if(!ctx) {
+    std::cerr << "Oups, no ExtFFContextGuard installed in this thread for ExtFFElem !!!" << std::endl;
+    std::abort();
+  }
+  return *ctx;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k>::ExtFFElem() {};
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k>::ExtFFElem(int v) {
+  coeffs_[0] = FFElem<p>(v);
+};
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k>::ExtFFElem(const FFElem<p> &v) {
+  coeffs_[0] = v;
+};
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k>::ExtFFElem(const Poly<FFElem<p>> &v) {
+  auto r = v.degree() < static_cast<int>(k) ? v : v % context().modulus();
+  for(int i = 0; i <= r.degree(); i++) {
+    coeffs_[i] = r.coeffs_[i];
+  }
+};
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> ExtFFElem<p, k>::generator() {
+  if(k == 1) {
+    // GF(p)[a] / (a - c): a is the constant c
+    return ExtFFElem<p, k>(-context().modulus().coeffs_[0]);
+  }
+  ExtFFElem<p, k> r;
+  r.coeffs_[1 % k] = FFElem<p>(1);
+  return r;
+}
+
+template <uint64_t p, unsigned int k>
+void ExtFFElem<p, k>::operator+=(const ExtFFElem<p, k> &other) {
+  for(unsigned int i = 0; i < k; i++) {
+    coeffs_[i] += other.coeffs_[i];
+  }
+}
+
+template <uint64_t p, unsigned int k>
+void ExtFFElem<p, k>::operator-=(const ExtFFElem<p, k> &other) {
+  for(unsigned int i = 0; i < k; i++) {
+    coeffs_[i] -= other.coeffs_[i];
+  }
+}
+
+template <uint64_t p, unsigned int k>
+void ExtFFElem<p, k>::operator*=(const ExtFFElem<p, k> &other) {
+  FFElem<p> product[2*k-1];
+  for(unsigned int i = 0; i < k; i++) {
+    for(unsigned int j = 0; j < k; j++) {
+      product[i+j] += coeffs_[i] * other.coeffs_[j];
+    }
+  }
+  // Fold a^(k+i) back using the precomputed reductions
+  const ExtFFContext<p, k> &ctx = context();
+  for(unsigned int i = 0; i + 1 < k; i++) {
+    for(unsigned int j = 0; j < k; j++) {
+      product[j] += product[k+i] * ctx.reduction_[i][j];
+    }
+  }
+  for(unsigned int i = 0; i < k; i++) {
+    coeffs_[i] = product[i];
+  }
+}
+
+template <uint64_t p, unsigned int k>
+void ExtFFElem<p, k>::operator/=(const ExtFFElem<p, k> &other) {
+  operator*=(other.inverse());
+}
+
+template <uint64_t p, unsigned int k>
+Poly<FFElem<p>> ExtFFElem<p, k>::toPoly() const {
+  Poly<FFElem<p>> r(std::vector<FFElem<p>>(coeffs_, coeffs_+k));
+  r.simplify();
+  return r;
+}
+
+/* Extended Euclid algorithm on polynomials, returns 0 as the inverse of 0 */
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> ExtFFElem<p, k>::inverse() const {
+  Poly<FFElem<p>> r0 = context().modulus();
+  Poly<FFElem<p>> r1 = toPoly();
+  Poly<FFElem<p>> s0;
+  Poly<FFElem<p>> s1 = Poly<FFElem<p>>::Xn(0);
+  if(r1.null()) {
+    return ExtFFElem<p, k>();
+  }
+  while(!r1.null()) {
+    auto qr = euclidDivide(r0, r1);
+    r0 = r1;
+    r1 = qr.second;
+    auto s = s0 - qr.first * s1;
+    s0 = s1;
+    s1 = s;
+  }
+  // r0 is the (constant) gcd of f and this element
+  return ExtFFElem<p, k>(s0 / r0.coeffs_[0]);
+}
+
+template <uint64_t p, unsigned int k>
+int ExtFFElem<p, k>::compare(const ExtFFElem<p, k> &other) const {
+  for(unsigned int i = k; i > 0; i--) {
+    int c = coeffs_[i-1].compare(other.coeffs_[i-1]);
+    if(c != 0) {
+      return c;
+    }
+  }
+  return 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator<(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) < 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator<=(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) <= 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator>(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) > 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator>=(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) >= 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator==(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) == 0;
+}
+
+template <uint64_t p, unsigned int k>
+bool operator!=(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  return a.compare(b) != 0;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> operator+(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  auto r = a;
+  r += b;
+  return r;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> operator-(const ExtFFElem<p, k> &a) {
+  ExtFFElem<p, k> r;
+  r -= a;
+  return r;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> operator-(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  auto r = a;
+  r -= b;
+  return r;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> operator*(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  auto r = a;
+  r *= b;
+  return r;
+}
+
+template <uint64_t p, unsigned int k>
+ExtFFElem<p, k> operator/(const ExtFFElem<p, k> &a, const ExtFFElem<p, k> &b) {
+  auto r = a;
+  r /= b;
+  return r;
+}
+
+/* Prints the coefficients from a^0 to a^(k-1), e.g. (1,2)[3^2] */
+template <uint64_t p, unsigned int k>
+void ExtFFElem<p, k>::toStream(std::ostream &s) const {
+  s << "(";
+  for(unsigned int i = 0; i < k; i++) {
+    if(i > 0) {
+      s << ",";
+    }
+    s << coeffs_[i].value();
+  }
+  s << ")[" << p << "^" << k << "]";
+}
+
+template <uint64_t p, unsigned int k>
+std::ostream &operator<<(std::ostream &s, const ExtFFElem<p, k> &v) {
+  v.toStream(s);
+  return s;
+}
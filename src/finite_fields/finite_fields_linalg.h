@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+ * Dense linear algebra over GF(n): reduced row echelon form and kernel of
+ * matrices of FFElem<n> stored row major.
+ *
+ * The elimination is blocked (delayed updates): pivots are searched for in
+ * panels of FF_ELIMINATION_PANEL columns, only these columns being updated
+ * while the panel is reduced. The multipliers are recorded and the rest of
+ * each row is then updated once for the whole panel, with the batch kernels.
+ * Each panel thus goes through the matrix once instead of once per pivot,
+ * the pivot rows of the panel staying in cache.
+ */
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include "finite_fields.h"
+#include "finite_fields_simd.h"
+
+// Number of columns of the panels of the elimination
+#ifndef FF_ELIMINATION_PANEL
+#define FF_ELIMINATION_PANEL 64
+#endif
+
+/*
+ * Reduces the rows x cols matrix a to its reduced row echelon form, in place
+ * and without exchanging rows. Returns the pivot row of each column, rows
+ * for the columns without a pivot.
+ */
+template <uint64_t n>
+std::vector<size_t> ffRowReduce(FFElem<n> *a, size_t rows, size_t cols) {
+  std::vector<size_t> pivotRows(cols, rows);
+  std::vector<bool> used(rows, false);
+  const size_t panel = FF_ELIMINATION_PANEL;
+  // m[r*panel+k]: multiple of the k-th pivot row of the panel subtracted from
+  // row r (for the pivot row itself, the inverse of the pivot)
+  std::vector<FFElem<n>> m(rows * panel);
+  std::vector<size_t> pivots;
+  // Index in the panel of the pivot rows of the panel, panel for the others
+  std::vector<size_t> index(rows, panel);
+  for(size_t c0 = 0; c0 < cols; c0 += panel) {
+    size_t c1 = std::min(c0 + panel, cols);
+    std::fill(m.begin(), m.end(), FFElem<n>(0));
+    pivots.clear();
+    // Gauss-Jordan elimination restricted to the columns of the panel
+    for(size_t c = c0; c < c1; c++) {
+      size_t p = 0;
+      while(p < rows && (used[p] || a[p*cols+c] == FFElem<n>(0))) {
+        p++;
+      }
+      if(p == rows) {
+        continue;
+      }
+      size_t k = pivots.size();
+      used[p] = true;
+      pivotRows[c] = p;
+      index[p] = k;
+      pivots.push_back(p);
+      FFElem<n> inverse = a[p*cols+c].inverse();
+      m[p*panel+k] = inverse;
+      ffScale(a + p*cols + c, inverse, c1 - c);
+      for(size_t r = 0; r < rows; r++) {
+        FFElem<n> x = a[r*cols+c];
+        if(r == p || x == FFElem<n>(0)) {
+          continue;
+        }
+        m[r*panel+k] = x;
+        ffAddMul(a + r*cols + c, a + p*cols + c, -x, c1 - c);
+      }
+    }
+    size_t len = cols - c1;
+    if(len > 0) {
+      // Same operations on the columns after the panel: pivot rows first, in
+      // the order of the panel (each one needs the previous ones)
+      for(size_t k = 0; k < pivots.size(); k++) {
+        size_t p = pivots[k];
+        for(size_t j = 0; j < k; j++) {
+          if(m[p*panel+j] != FFElem<n>(0)) {
+            ffAddMul(a + p*cols + c1, a + pivots[j]*cols + c1, -m[p*panel+j], len);
+          }
+        }
+        ffScale(a + p*cols + c1, m[p*panel+k], len);
+      }
+      // Then the other rows
+      for(size_t r = 0; r < rows; r++) {
+        for(size_t k = 0; index[r] == panel && k < pivots.size(); k++) {
+          if(m[r*panel+k] != FFElem<n>(0)) {
+            ffAddMul(a + r*cols + c1, a + pivots[k]*cols + c1, -m[r*panel+k], len);
+          }
+        }
+      }
+      // And the pivot rows for the later pivots of the panel, which must not
+      // have been updated yet
+      for(size_t k = 0; k < pivots.size(); k++) {
+        size_t p = pivots[k];
+        for(size_t j = k+1; j < pivots.size(); j++) {
+          if(m[p*panel+j] != FFElem<n>(0)) {
+            ffAddMul(a + p*cols + c1, a + pivots[j]*cols + c1, -m[p*panel+j], len);
+          }
+        }
+      }
+    }
+    for(size_t k = 0; k < pivots.size(); k++) {
+      index[pivots[k]] = panel;
+    }
+  }
+  return pivotRows;
+}
+
+/* Basis of the kernel {v : a v = 0} of the rows x cols matrix a */
+template <uint64_t n>
+std::vector<std::vector<FFElem<n>>> ffNullspace(std::vector<FFElem<n>> a, size_t rows, size_t cols) {
+  std::vector<size_t> pivotRows = ffRowReduce(a.data(), rows, cols);
+  std::vector<std::vector<FFElem<n>>> basis;
+  for(size_t f = 0; f < cols; f++) {
+    if(pivotRows[f] != rows) {
+      continue;
+    }
+    // Free variable f set to 1, the pivot variables following
+    std::vector<FFElem<n>> v(cols);
+    v[f] = FFElem<n>(1);
+    for(size_t c = 0; c < cols; c++) {
+      if(pivotRows[c] != rows) {
+        v[c] = -a[pivotRows[c]*cols + f];
+      }
+    }
+    basis.push_back(v);
+  }
+  return basis;
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+/*
+ * Elements of GF(n) for n a prime below 2^16, multiplied and divided using
+ * tables of discrete logarithms and of powers of a generator of GF(n)*: a
+ * product is g^(log(a) + log(b)), with no division nor modulo. The tables are
+ * built once per prime, the first time they are needed.
+ *
+ * This is an opt-in replacement for FFElem<n> as the coefficient type of
+ * Poly<T> when n is small: Poly<LogFFElem<n>> only does table lookups,
+ * additions and comparisons.
+ */
+#include <iostream>
+#include <cstdint>
+
+template <unsigned int n>
+class FFLogTables {
+  public:
+    FFLogTables();
+
+    // log_[x] = k such that g^k = x, for 0 < x < n
+    uint16_t log_[n];
+    // exp_[k] = g^k, for k < 2(n-1) so that sums of two logs need no reduction
+    uint16_t exp_[2*(n-1)];
+};
+
+template <unsigned int n>
+FFLogTables<n>::FFLogTables() {
+  log_[0] = 0;
+  // Look for a generator: the smallest g whose powers go through all GF(n)*.
+  // For n composite, the powers of a zero divisor never get back to 1.
+  for(unsigned int g = 1; g < n; g++) {
+    uint32_t x = 1;
+    unsigned int order = 0;
+    do {
+      exp_[order] = x;
+      log_[x] = order;
+      x = x * g % n;
+      order++;
+    } while(x != 1 && x != 0 && order < n-1);
+    if(x == 1 && order == n-1) {
+      for(unsigned int k = n-1; k < 2*(n-1); k++) {
+        exp_[k] = exp_[k-(n-1)];
+      }
+      return;
+    }
+  }
+  std::cerr << "Oups, no generator found for GF(" << n << "): " << n << " is not prime !!!" << std::endl;
+}
+
+template <unsigned int n>
+class LogFFElem {
+  static_assert(n >= 2 && n < (1u << 16), "LogFFElem requires a prime below 2^16");
+
+  public:
+    static const unsigned int characteristic;
+
+    LogFFElem<n>();
+    LogFFElem<n>(unsigned int v);
+    LogFFElem<n>(int v);
+
+    void operator+=(const LogFFElem<n> &other);
+    void operator-=(const LogFFElem<n> &other);
+    void operator*=(const LogFFElem<n> &other);
+    void operator/=(const LogFFElem<n> &other);
+
+    int compare(const LogFFElem<n> &other) const;
+    void toStream(std::ostream &s) const;
+    LogFFElem<n> inverse() const;
+    unsigned int value() const;
+
+  protected:
+    static const FFLogTables<n> &tables();
+
+		uint16_t val_;
+};
+
+template <unsigned int n>
+const unsigned int LogFFElem<n>::characteristic = n;
+
+template <unsigned int n>
+const FFLogTables<n> &LogFFElem<n>::tables() {
+  static const FFLogTables<n> t;
+  return t;
+}
+
+template <unsigned int n>
+LogFFElem<n>::LogFFElem() : val_(0) {};
+
+template <unsigned int n>
+LogFFElem<n>::LogFFElem(unsigned int v) : val_(v % n) {};
+
+template <unsigned int n>
+LogFFElem<n>::LogFFElem(int v) {
+  int r = v % static_cast<int>(n);
+  if(r < 0) {
+    r += n;
+  }
+  val_ = r;
+};
+
+template <unsigned int n>
+void LogFFElem<n>::operator+=(const LogFFElem<n> &other) {
+  unsigned int r = val_ + other.val_;
+  val_ = r >= n ? r - n : r;
+}
+
+template <unsigned int n>
+void LogFFElem<n>::operator-=(const LogFFElem<n> &other) {
+  unsigned int r = val_;
+  if(other.val_ > val_) {
+    r += n;
+  }
+  val_ = r - other.val_;
+}
+
+template <unsigned int n>
+void LogFFElem<n>::operator*=(const LogFFElem<n> &other) {
+  if(val_ == 0 || other.val_ == 0) {
+    val_ = 0;
+    return;
+  }
+  const FFLogTables<n> &t = tables();
+  val_ = t.exp_[t.log_[val_] + t.log_[other.val_]];
+}
+
+/* Division by 0 gives 0, as the inverse of 0 is 0 */
+template <unsigned int n>
+void LogFFElem<n>::operator/=(const LogFFElem<n> &other) {
+  if(val_ == 0 || other.val_ == 0) {
+    val_ = 0;
+    return;
+  }
+  const FFLogTables<n> &t = tables();
+  val_ = t.exp_[t.log_[val_] + (n-1) - t.log_[other.val_]];
+}
+
+template <unsigned int n>
+unsigned int LogFFElem<n>::value() const {
+  return val_;
+}
+
+template <unsigned int n>
+int LogFFElem<n>::compare(const LogFFElem<n> &other) const {
+  if(val_ < other.val_) {
+    return -1;
+  } else if(val_ > other.val_) {
+    return 1;
+  }
+  return 0;
+}
+
+template <unsigned int n>
+bool operator<(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) < 0;
+}
+
+template <unsigned int n>
+bool operator<=(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) <= 0;
+}
+
+template <unsigned int n>
+bool operator>(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) > 0;
+}
+
+template <unsigned int n>
+bool operator>=(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) >= 0;
+}
+
+template <unsigned int n>
+bool operator==(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) == 0;
+}
+
+template <unsigned int n>
+bool operator!=(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  return a.compare(b) != 0;
+}
+
+template <unsigned int n>
+LogFFElem<n> operator+(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  auto r = a;
+  r += b;
+  return r;
+}
+
+template <unsigned int n>
+LogFFElem<n> operator-(const LogFFElem<n> &a) {
+  LogFFElem<n> r;
+  r -= a;
+  return r;
+}
+
+template <unsigned int n>
+LogFFElem<n> operator-(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  auto r = a;
+  r -= b;
+  return r;
+}
+
+template <unsigned int n>
+LogFFElem<n> operator*(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  auto r = a;
+  r *= b;
+  return r;
+}
+
+template <unsigned int n>
+LogFFElem<n> operator/(const LogFFElem<n> &a, const LogFFElem<n> &b) {
+  auto r = a;
+  r /= b;
+  return r;
+}
+
+/* g^-k = g^(n-1-k), returns 0 as the inverse of 0 */
+template <unsigned int n>
+LogFFElem<n> LogFFElem<n>::inverse() const {
+  LogFFElem<n> r;
+  if(val_ != 0) {
+    const FFLogTables<n> &t = tables();
+    r.val_ = t.exp_[(n-1) - t.log_[val_]];
+  }
+  return r;
+}
+
+template <unsigned int n>
+void LogFFElem<n>::toStream(std::ostream &s) const {
+  s << val_ << "[" << n << "]";
+}
+
+template <unsigned int n>
+std::ostream &operator<<(std::ostream &s, const LogFFElem<n> &v) {
+  v.toStream(s);
+  return s;
+}
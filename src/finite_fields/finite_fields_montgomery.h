@@ -0,0 +1,223 @@
+#pragma once
+
+/*
+ * Elements of GF(n) for n an odd prime below 2^31, stored in Montgomery form
+ * (x*2^32 mod n). All the constants needed by the reduction are computed at
+ * compile time from n, so that arithmetic never uses a hardware division.
+ * Values are converted from / to the plain form at the API edge only
+ * (constructors, compare, toStream and value), which makes MontFFElem<n> a
+ * drop-in replacement for FFElem<n> as the coefficient type of Poly<T>.
+ */
+#include <iostream>
+#include <cstdint>
+
+// n^-1 mod 2^32 by Newton iteration: each step doubles the number of correct
+// bits, starting with 3 correct bits for x = n.
+constexpr uint32_t montgomeryInverseStep(uint32_t n, uint32_t x, int steps) {
+  return steps == 0 ? x : montgomeryInverseStep(n, x*(2u - n*x), steps-1);
+}
+
+constexpr uint32_t montgomeryNegInverse(uint32_t n) {
+  return 0u - montgomeryInverseStep(n, n, 4);
+}
+
+template <unsigned int n>
+class MontFFElem {
+  static_assert(n % 2 == 1 && n < (1u << 31), "MontFFElem requires an odd modulus below 2^31");
+
+  public:
+    static const unsigned int characteristic;
+
+    MontFFElem<n>();
+    MontFFElem<n>(unsigned int v);
+    MontFFElem<n>(int v);
+
+    void operator+=(const MontFFElem<n> &other);
+    void operator-=(const MontFFElem<n> &other);
+    void operator*=(const MontFFElem<n> &other);
+    void operator/=(const MontFFElem<n> &other);
+
+    int compare(const MontFFElem<n> &other) const;
+    void toStream(std::ostream &s) const;
+    MontFFElem<n> inverse() const;
+    // Plain (non Montgomery) representative in [0, n).
+    unsigned int value() const;
+
+  protected:
+    static constexpr uint32_t nInv = montgomeryNegInverse(n);
+    // 2^64 mod n, used to bring a plain value into Montgomery form.
+    static constexpr uint32_t r2 = (UINT64_MAX % n + 1) % n;
+
+    static uint32_t reduce(uint64_t t);
+    static uint32_t toMontgomery(uint32_t v);
+
+		uint32_t val_;
+};
+
+template <unsigned int n>
+constexpr uint32_t MontFFElem<n>::nInv;
+
+template <unsigned int n>
+constexpr uint32_t MontFFElem<n>::r2;
+
+template <unsigned int n>
+const unsigned int MontFFElem<n>::characteristic = n;
+
+/* Montgomery reduction: returns t*2^-32 mod n for t < n*2^32 */
+template <unsigned int n>
+uint32_t MontFFElem<n>::reduce(uint64_t t) {
+  uint32_t m = static_cast<uint32_t>(t) * nInv;
+  uint32_t r = (t + static_cast<uint64_t>(m) * n) >> 32;
+  return r >= n ? r - n : r;
+}
+
+template <unsigned int n>
+uint32_t MontFFElem<n>::toMontgomery(uint32_t v) {
+  return reduce(static_cast<uint64_t>(v) * r2);
+}
+
+template <unsigned int n>
+MontFFElem<n>::MontFFElem() : val_(0) {};
+
+template <unsigned int n>
+MontFFElem<n>::MontFFElem(unsigned int v) : val_(toMontgomery(v % n)) {};
+
+template <unsigned int n>
+MontFFElem<n>::MontFFElem(int v) {
+  int r = v % static_cast<int>(n);
+  if(r < 0) {
+    r += n;
+  }
+  val_ = toMontgomery(r);
+};
+
+template <unsigned int n>
+void MontFFElem<n>::operator+=(const MontFFElem<n> &other) {
+  val_ += other.val_;
+  if(val_ >= n) {
+    val_ -= n;
+  }
+}
+
+template <unsigned int n>
+void MontFFElem<n>::operator-=(const MontFFElem<n> &other) {
+  if(other.val_ > val_) {
+    val_ += n;
+  }
+  val_ -= other.val_;
+}
+
+template <unsigned int n>
+void MontFFElem<n>::operator*=(const MontFFElem<n> &other) {
+  val_ = reduce(static_cast<uint64_t>(val_) * other.val_);
+}
+
+template <unsigned int n>
+void MontFFElem<n>::operator/=(const MontFFElem<n> &other) {
+  operator*=(other.inverse());
+}
+
+template <unsigned int n>
+unsigned int MontFFElem<n>::value() const {
+  return reduce(val_);
+}
+
+template <unsigned int n>
+int MontFFElem<n>::compare(const MontFFElem<n> &other) const {
+  // Equality can be checked on the Montgomery form but ordering must follow
+  // the plain values so that Poly<T> prints the same as with FFElem<n>.
+  if(val_ == other.val_) {
+    return 0;
+  }
+  return value() < other.value() ? -1 : 1;
+}
+
+template <unsigned int n>
+bool operator<(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) < 0;
+}
+
+template <unsigned int n>
+bool operator<=(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) <= 0;
+}
+
+template <unsigned int n>
+bool operator>(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) > 0;
+}
+
+template <unsigned int n>
+bool operator>=(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) >= 0;
+}
+
+template <unsigned int n>
+bool operator==(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) == 0;
+}
+
+template <unsigned int n>
+bool operator!=(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  return a.compare(b) != 0;
+}
+
+template <unsigned int n>
+MontFFElem<n> operator+(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  auto r = a;
+  r += b;
+  return r;
+}
+
+template <unsigned int n>
+MontFFElem<n> operator-(const MontFFElem<n> &a) {
+  MontFFElem<n> r(0);
+  r -= a;
+  return r;
+}
+
+template <unsigned int n>
+MontFFElem<n> operator-(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  auto r = a;
+  r -= b;
+  return r;
+}
+
+template <unsigned int n>
+MontFFElem<n> operator*(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  auto r = a;
+  r *= b;
+  return r;
+}
+
+template <unsigned int n>
+MontFFElem<n> operator/(const MontFFElem<n> &a, const MontFFElem<n> &b) {
+  auto r = a;
+  r /= b;
+  return r;
+}
+
+/* Fermat's little theorem: a^-1 = a^(n-2) */
+template <unsigned int n>
+MontFFElem<n> MontFFElem<n>::inverse() const {
+  MontFFElem<n> result(1);
+  MontFFElem<n> base(*this);
+  for(unsigned int e = n-2; e > 0; e >>= 1) {
+    if(e & 1) {
+      result *= base;
+    }
+    base *= base;
+  }
+  return result;
+}
+
+template <unsigned int n>
+void MontFFElem<n>::toStream(std::ostream &s) const {
+  s << value() << "[" << n << "]";
+}
+
+template <unsigned int n>
+std::ostream &operator<<(std::ostream &s, const MontFFElem<n> &v) {
+  v.toStream(s);
+  return s;
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+/*
+ * Elements of GF(p) for a prime p below 2^32 chosen at runtime.
+ *
+ * The modulus and its reduction constants live in a FFContext shared by all
+ * elements. To keep elements as small and fast as FFElem<n> (and usable as the
+ * coefficient type of Poly<T>, which creates elements from plain integers),
+ * they don't store a pointer to their context: all DynFFElem of a thread use
+ * the context installed by the innermost live FFContextGuard of this thread.
+ * Every thread creating or computing with elements thus needs a guard, the
+ * program aborting otherwise. The pool tasks of the parallel algorithms of
+ * Poly<T> get the context of the thread starting them (see coeffsContext in
+ * polynomial_ff.h).
+ *
+ *   auto ctx = std::make_shared<FFContext>(p);
+ *   FFContextGuard guard(ctx);
+ *   Poly<DynFFElem> f({1, 0, 1});
+ */
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+class FFContext {
+  public:
+    // p prime, below 2^32
+    FFContext(uint64_t p);
+
+    uint64_t modulus() const;
+    // Returns x mod p, using Barrett reduction (no hardware division).
+    uint64_t reduce(uint64_t x) const;
+
+  protected:
+    uint64_t p_;
+    // floor((2^64-1) / p)
+    uint64_t barrett_;
+};
+
+inline FFContext::FFContext(uint64_t p) : p_(p), barrett_(0) {
+  // Elements are stored on 32 bits, and their products must fit in 64 bits
+  if(p < 2 || p >= (uint64_t(1) << 32)) {
+    std::cerr << "Oups, FFContext modulus " << p << " is not between 2 and 2^32 !!!" << std::endl;
+    std::abort();
+  }
+  barrett_ = UINT64_MAX / p;
+}
+
+inline uint64_t FFContext::modulus() const {
+  return p_;
+}
+
+inline uint64_t FFContext::reduce(uint64_t x) const {
+  uint64_t q = (static_cast<unsigned __int128>(x) * barrett_) >> 64;
+  uint64_t r = x - q * p_;
+  while(r >= p_) {
+    r -= p_;
+  }
+  return r;
+}
+
+class FFContextGuard;
+
+class DynFFElem {
+  friend class FFContextGuard;
+
+  public:
+    DynFFElem();
+    DynFFElem(unsigned int v);
+    DynFFElem(int v);
+    DynFFElem(uint64_t v);
+    DynFFElem(int64_t v);
+
+    static uint64_t characteristic();
+    static const FFContext &context();
+
+    void operator+=(const DynFFElem &other);
+    void operator-=(const DynFFElem &other);
+    void operator*=(const DynFFElem &other);
+    void operator/=(const DynFFElem &other);
+
+    int compare(const DynFFElem &other) const;
+    void toStream(std::ostream &s) const;
+    DynFFElem inverse() const;
+    uint64_t value() const;
+
+  protected:
+    static const FFContext *&current();
+
+		uint32_t val_;
+};
+
+/*
+ * Installs a context for the DynFFElem of the current thread for the lifetime
+ * of the guard, restoring the previous one afterwards.
+ */
+class FFContextGuard {
+  public:
+    FFContextGuard(std::shared_ptr<const FFContext> ctx);
+    // Installs a context owned elsewhere, e.g. by the guard of another thread
+    FFContextGuard(const FFContext *ctx);
+    ~FFContextGuard();
+
+    // Context of the calling thread, nullptr if there is none
+    static const FFContext *installed();
+
+    FFContextGuard(const FFContextGuard &) = delete;
+    FFContextGuard &operator=(const FFContextGuard &) = delete;
+
+  protected:
+    std::shared_ptr<const FFContext> ctx_;
+    const FFContext *previous_;
+};
+
+inline FFContextGuard::FFContextGuard(std::shared_ptr<const FFContext> ctx) : ctx_(ctx) {
+  previous_ = DynFFElem::current();
+  DynFFElem::current() = ctx_.get();
+}
+
+inline FFContextGuard::FFContextGuard(const FFContext *ctx) {
+  previous_ = DynFFElem::current();
+  DynFFElem::current() = ctx;
+}
+
+inline FFContextGuard::~FFContextGuard() {
+  DynFFElem::current() = previous_;
+}
+
+inline const FFContext *FFContextGuard::installed() {
+  return DynFFElem::current();
+}
+
+inline const FFContext *&DynFFElem::current() {
+  thread_local const FFContext *ctx = nullptr;
+  return ctx;
+}
+
+inline const FFContext &DynFFElem::context() {
+  const FFContext *ctx = current();
+  if(!ctx) {
+    std::cerr << "Oups, no FFContextGuard installed in this thread for DynFFElem !!!" << std::endl;
+    std::abort();
+  }
+  return *ctx;
+}
+
+inline uint64_t DynFFElem::characteristic() {
+  return context().modulus();
+}
+
+inline DynFFElem::DynFFElem() : val_(0) {};
+
+inline DynFFElem::DynFFElem(unsigned int v) : val_(context().reduce(v)) {};
+
+inline DynFFElem::DynFFElem(int v) : DynFFElem(static_cast<int64_t>(v)) {};
+
+inline DynFFElem::DynFFElem(uint64_t v) : val_(context().reduce(v)) {};
+
+inline DynFFElem::DynFFElem(int64_t v) {
+  int64_t p = characteristic();
+  int64_t r = v % p;
+  if(r < 0) {
+    r += p;
+  }
+  val_ = r;
+};
+
+inline void DynFFElem::operator+=(const DynFFElem &other) {
+  uint64_t r = static_cast<uint64_t>(val_) + other.val_;
+  uint64_t p = characteristic();
+  val_ = r >= p ? r - p : r;
+}
+
+inline void DynFFElem::operator-=(const DynFFElem &other) {
+  uint64_t r = val_;
+  if(other.val_ > val_) {
+    r += characteristic();
+  }
+  val_ = r - other.val_;
+}
+
+inline void DynFFElem::operator*=(const DynFFElem &other) {
+  val_ = context().reduce(static_cast<uint64_t>(val_) * other.val_);
+}
+
+inline void DynFFElem::operator/=(const DynFFElem &other) {
+  operator*=(other.inverse());
+}
+
+inline uint64_t DynFFElem::value() const {
+  return val_;
+}
+
+inline int DynFFElem::compare(const DynFFElem &other) const {
+  if(val_ < other.val_) {
+    return -1;
+  } else if(val_ > other.val_) {
+    return 1;
+  }
+  return 0;
+}
+
+inline bool operator<(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) < 0;
+}
+
+inline bool operator<=(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) <= 0;
+}
+
+inline bool operator>(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) > 0;
+}
+
+inline bool operator>=(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) >= 0;
+}
+
+inline bool operator==(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) == 0;
+}
+
+inline bool operator!=(const DynFFElem &a, const DynFFElem &b) {
+  return a.compare(b) != 0;
+}
+
+inline DynFFElem operator+(const DynFFElem &a, const DynFFElem &b) {
+  auto r = a;
+  r += b;
+  return r;
+}
+
+inline DynFFElem operator-(const DynFFElem &a) {
+  DynFFElem r;
+  r -= a;
+  return r;
+}
+
+inline DynFFElem operator-(const DynFFElem &a, const DynFFElem &b) {
+  auto r = a;
+  r -= b;
+  return r;
+}
+
+inline DynFFElem operator*(const DynFFElem &a, const DynFFElem &b) {
+  auto r = a;
+  r *= b;
+  return r;
+}
+
+inline DynFFElem operator/(const DynFFElem &a, const DynFFElem &b) {
+  auto r = a;
+  r /= b;
+  return r;
+}
+
+/* Extended Euclid algorithm, returns 0 as the inverse of 0 */
+inline DynFFElem DynFFElem::inverse() const {
+  int64_t t = 0, newt = 1;
+  int64_t r = characteristic(), newr = val_;
+  while(newr != 0) {
+    int64_t q = r / newr;
+    int64_t tmp = t - q * newt;
+    t = newt;
+    newt = tmp;
+    tmp = r - q * newr;
+    r = newr;
+    newr = tmp;
+  }
+  return DynFFElem(t);
+}
+
+inline void DynFFElem::toStream(std::ostream &s) const {
+  s << val_ << "[" << characteristic() << "]";
+}
+
+inline std::ostream &operator<<(std::ostream &s, const DynFFElem &v) {
+  v.toStream(s);
+  return s;
+}
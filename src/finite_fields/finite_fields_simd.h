@@ -0,0 +1,455 @@
+#pragma once
+
+/*
+ * Batch kernels on contiguous arrays of FFElem<n>.
+ *
+ * For primes below 2^31 (elements stored on 32 bits), the kernels work
+ * directly on the array of words with AVX2 or SSE4.1 when the CPU supports
+ * them (checked once at runtime), falling back to plain loops otherwise.
+ * Products use Montgomery reduction so that no division is needed in the
+ * loops. Larger primes always use the scalar FFElem<n> operations.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "finite_fields.h"
+#include "finite_fields_montgomery.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FF_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Reduction constants for the 32 bits kernels */
+struct FFSimdModulus {
+  FFSimdModulus(uint32_t p);
+
+  // Montgomery form of v (v*2^32 mod p)
+  uint32_t toMontgomery(uint32_t v) const;
+
+  uint32_t p;
+  // -p^-1 mod 2^32
+  uint32_t pInv;
+  // 2^64 mod p
+  uint32_t r2;
+};
+
+inline FFSimdModulus::FFSimdModulus(uint32_t p) : p(p), pInv(montgomeryNegInverse(p)), r2((UINT64_MAX % p + 1) % p) {}
+
+inline uint32_t FFSimdModulus::toMontgomery(uint32_t v) const {
+  return (static_cast<uint64_t>(v) << 32) % p;
+}
+
+/* Returns t*2^-32 mod p for t < p*2^32 */
+inline uint32_t ffMontgomeryReduce(uint64_t t, const FFSimdModulus &m) {
+  uint32_t q = static_cast<uint32_t>(t) * m.pInv;
+  uint32_t r = (t + static_cast<uint64_t>(q) * m.p) >> 32;
+  return r >= m.p ? r - m.p : r;
+}
+
+/*
+ * Scalar versions, used as fallback and for the tails of the vectorized loops.
+ * All of them require odd p below 2^31 for the Montgomery based products.
+ */
+inline void ffAddScalar(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  for(size_t i = 0; i < len; i++) {
+    uint32_t s = dst[i] + src[i];
+    dst[i] = s >= m.p ? s - m.p : s;
+  }
+}
+
+inline void ffSubScalar(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  for(size_t i = 0; i < len; i++) {
+    uint32_t d = dst[i] - src[i];
+    dst[i] = dst[i] < src[i] ? d + m.p : d;
+  }
+}
+
+/* dst[i] = dst[i] * c where cMont is the Montgomery form of c */
+inline void ffScaleScalar(uint32_t *dst, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] = ffMontgomeryReduce(static_cast<uint64_t>(dst[i]) * cMont, m);
+  }
+}
+
+/* dst[i] += src[i] * c where cMont is the Montgomery form of c */
+inline void ffAddMulScalar(uint32_t *dst, const uint32_t *src, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  for(size_t i = 0; i < len; i++) {
+    uint32_t s = dst[i] + ffMontgomeryReduce(static_cast<uint64_t>(src[i]) * cMont, m);
+    dst[i] = s >= m.p ? s - m.p : s;
+  }
+}
+
+/* dst[i] = dst[i] * src[i] */
+inline void ffMulScalar(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  for(size_t i = 0; i < len; i++) {
+    uint32_t r = ffMontgomeryReduce(static_cast<uint64_t>(dst[i]) * src[i], m);
+    dst[i] = ffMontgomeryReduce(static_cast<uint64_t>(r) * m.r2, m);
+  }
+}
+
+/* Unreduced sum of the a[i] * b[i], the caller makes sure that it fits in 64 bits */
+inline uint64_t ffDotScalar(const uint32_t *a, const uint32_t *b, size_t len) {
+  uint64_t acc = 0;
+  for(size_t i = 0; i < len; i++) {
+    acc += static_cast<uint64_t>(a[i]) * b[i];
+  }
+  return acc;
+}
+
+#ifdef FF_SIMD_X86
+
+/*
+ * AVX2 versions, working on 8 elements at a time. The conditional subtraction
+ * of p is branch free: for x < 2p, min(x, x-p) (unsigned) is x mod p.
+ */
+__attribute__((target("avx2")))
+inline __m256i ffMontgomeryReduceAvx2(__m256i a, __m256i b, __m256i p, __m256i pInv) {
+  // 64 bits products of the even and odd lanes
+  __m256i tEven = _mm256_mul_epu32(a, b);
+  __m256i tOdd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+  __m256i qEven = _mm256_mul_epu32(tEven, pInv);
+  __m256i qOdd = _mm256_mul_epu32(tOdd, pInv);
+  __m256i rEven = _mm256_add_epi64(tEven, _mm256_mul_epu32(qEven, p));
+  __m256i rOdd = _mm256_add_epi64(tOdd, _mm256_mul_epu32(qOdd, p));
+  // Results are in the high halves of the 64 bits lanes
+  __m256i r = _mm256_blend_epi32(_mm256_srli_epi64(rEven, 32), rOdd, 0xAA);
+  return _mm256_min_epu32(r, _mm256_sub_epi32(r, p));
+}
+
+__attribute__((target("avx2")))
+inline void ffAddAvx2(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m256i p = _mm256_set1_epi32(m.p);
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i s = _mm256_add_epi32(a, b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_min_epu32(s, _mm256_sub_epi32(s, p)));
+  }
+  ffAddScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("avx2")))
+inline void ffSubAvx2(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m256i p = _mm256_set1_epi32(m.p);
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i d = _mm256_sub_epi32(a, b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_min_epu32(d, _mm256_add_epi32(d, p)));
+  }
+  ffSubScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("avx2")))
+inline void ffScaleAvx2(uint32_t *dst, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  __m256i p = _mm256_set1_epi32(m.p);
+  __m256i pInv = _mm256_set1_epi32(m.pInv);
+  __m256i c = _mm256_set1_epi32(cMont);
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), ffMontgomeryReduceAvx2(a, c, p, pInv));
+  }
+  ffScaleScalar(dst + i, cMont, len - i, m);
+}
+
+__attribute__((target("avx2")))
+inline void ffAddMulAvx2(uint32_t *dst, const uint32_t *src, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  __m256i p = _mm256_set1_epi32(m.p);
+  __m256i pInv = _mm256_set1_epi32(m.pInv);
+  __m256i c = _mm256_set1_epi32(cMont);
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i s = _mm256_add_epi32(a, ffMontgomeryReduceAvx2(b, c, p, pInv));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_min_epu32(s, _mm256_sub_epi32(s, p)));
+  }
+  ffAddMulScalar(dst + i, src + i, cMont, len - i, m);
+}
+
+__attribute__((target("avx2")))
+inline void ffMulAvx2(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m256i p = _mm256_set1_epi32(m.p);
+  __m256i pInv = _mm256_set1_epi32(m.pInv);
+  __m256i r2 = _mm256_set1_epi32(m.r2);
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i r = ffMontgomeryReduceAvx2(ffMontgomeryReduceAvx2(a, b, p, pInv), r2, p, pInv);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), r);
+  }
+  ffMulScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("avx2")))
+inline uint64_t ffDotAvx2(const uint32_t *a, const uint32_t *b, size_t len) {
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    acc = _mm256_add_epi64(acc, _mm256_mul_epu32(x, y));
+    acc = _mm256_add_epi64(acc, _mm256_mul_epu32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32)));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + ffDotScalar(a + i, b + i, len - i);
+}
+
+/* SSE4.1 versions, working on 4 elements at a time */
+__attribute__((target("sse4.1")))
+inline __m128i ffMontgomeryReduceSse4(__m128i a, __m128i b, __m128i p, __m128i pInv) {
+  __m128i tEven = _mm_mul_epu32(a, b);
+  __m128i tOdd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  __m128i qEven = _mm_mul_epu32(tEven, pInv);
+  __m128i qOdd = _mm_mul_epu32(tOdd, pInv);
+  __m128i rEven = _mm_add_epi64(tEven, _mm_mul_epu32(qEven, p));
+  __m128i rOdd = _mm_add_epi64(tOdd, _mm_mul_epu32(qOdd, p));
+  __m128i r = _mm_blend_epi16(_mm_srli_epi64(rEven, 32), rOdd, 0xCC);
+  return _mm_min_epu32(r, _mm_sub_epi32(r, p));
+}
+
+__attribute__((target("sse4.1")))
+inline void ffAddSse4(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m128i p = _mm_set1_epi32(m.p);
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i s = _mm_add_epi32(a, b);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_min_epu32(s, _mm_sub_epi32(s, p)));
+  }
+  ffAddScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("sse4.1")))
+inline void ffSubSse4(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m128i p = _mm_set1_epi32(m.p);
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i d = _mm_sub_epi32(a, b);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_min_epu32(d, _mm_add_epi32(d, p)));
+  }
+  ffSubScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("sse4.1")))
+inline void ffScaleSse4(uint32_t *dst, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  __m128i p = _mm_set1_epi32(m.p);
+  __m128i pInv = _mm_set1_epi32(m.pInv);
+  __m128i c = _mm_set1_epi32(cMont);
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), ffMontgomeryReduceSse4(a, c, p, pInv));
+  }
+  ffScaleScalar(dst + i, cMont, len - i, m);
+}
+
+__attribute__((target("sse4.1")))
+inline void ffAddMulSse4(uint32_t *dst, const uint32_t *src, uint32_t cMont, size_t len, const FFSimdModulus &m) {
+  __m128i p = _mm_set1_epi32(m.p);
+  __m128i pInv = _mm_set1_epi32(m.pInv);
+  __m128i c = _mm_set1_epi32(cMont);
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i s = _mm_add_epi32(a, ffMontgomeryReduceSse4(b, c, p, pInv));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_min_epu32(s, _mm_sub_epi32(s, p)));
+  }
+  ffAddMulScalar(dst + i, src + i, cMont, len - i, m);
+}
+
+__attribute__((target("sse4.1")))
+inline void ffMulSse4(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m) {
+  __m128i p = _mm_set1_epi32(m.p);
+  __m128i pInv = _mm_set1_epi32(m.pInv);
+  __m128i r2 = _mm_set1_epi32(m.r2);
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i r = ffMontgomeryReduceSse4(ffMontgomeryReduceSse4(a, b, p, pInv), r2, p, pInv);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), r);
+  }
+  ffMulScalar(dst + i, src + i, len - i, m);
+}
+
+__attribute__((target("sse4.1")))
+inline uint64_t ffDotSse4(const uint32_t *a, const uint32_t *b, size_t len) {
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for(; i + 4 <= len; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    acc = _mm_add_epi64(acc, _mm_mul_epu32(x, y));
+    acc = _mm_add_epi64(acc, _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32)));
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  return lanes[0] + lanes[1] + ffDotScalar(a + i, b + i, len - i);
+}
+
+#endif
+
+/* Table of the best kernels supported by the CPU, selected on first use */
+struct FFSimdKernels {
+  void (*add)(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m);
+  void (*sub)(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m);
+  void (*scale)(uint32_t *dst, uint32_t cMont, size_t len, const FFSimdModulus &m);
+  void (*addMul)(uint32_t *dst, const uint32_t *src, uint32_t cMont, size_t len, const FFSimdModulus &m);
+  void (*mul)(uint32_t *dst, const uint32_t *src, size_t len, const FFSimdModulus &m);
+  uint64_t (*dot)(const uint32_t *a, const uint32_t *b, size_t len);
+};
+
+inline FFSimdKernels ffSelectSimdKernels() {
+#ifdef FF_SIMD_X86
+  if(__builtin_cpu_supports("avx2")) {
+    return FFSimdKernels{ffAddAvx2, ffSubAvx2, ffScaleAvx2, ffAddMulAvx2, ffMulAvx2, ffDotAvx2};
+  }
+  if(__builtin_cpu_supports("sse4.1")) {
+    return FFSimdKernels{ffAddSse4, ffSubSse4, ffScaleSse4, ffAddMulSse4, ffMulSse4, ffDotSse4};
+  }
+#endif
+  return FFSimdKernels{ffAddScalar, ffSubScalar, ffScaleScalar, ffAddMulScalar, ffMulScalar, ffDotScalar};
+}
+
+inline const FFSimdKernels &ffSimdKernels() {
+  static const FFSimdKernels kernels = ffSelectSimdKernels();
+  return kernels;
+}
+
+/*
+ * Batch operations on FFElem<n> arrays. The 32 bits kernels apply to odd
+ * primes whose elements are stored on 32 bits, other fields use the scalar
+ * operations of FFElem<n>.
+ */
+template <uint64_t n, bool simd = (n % 2 == 1 && std::is_same<typename FFElem<n>::word, uint32_t>::value)>
+struct FFBatch {
+  static void add(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      dst[i] += src[i];
+    }
+  }
+
+  static void sub(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      dst[i] -= src[i];
+    }
+  }
+
+  static void scale(FFElem<n> *dst, const FFElem<n> &c, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      dst[i] *= c;
+    }
+  }
+
+  static void addMul(FFElem<n> *dst, const FFElem<n> *src, const FFElem<n> &c, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      dst[i] += c * src[i];
+    }
+  }
+
+  static void mul(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      dst[i] *= src[i];
+    }
+  }
+
+  static typename FFElem<n>::wide dot(const FFElem<n> *a, const FFElem<n> *b, size_t len) {
+    typename FFElem<n>::wide acc = 0;
+    for(size_t i = 0; i < len; i++) {
+      acc += static_cast<typename FFElem<n>::wide>(a[i].value()) * b[i].value();
+    }
+    return acc;
+  }
+};
+
+template <uint64_t n>
+struct FFBatch<n, true> {
+  static_assert(sizeof(FFElem<n>) == sizeof(uint32_t), "FFElem<n> must be a single 32 bits word");
+
+  static uint32_t *words(FFElem<n> *a) {
+    return reinterpret_cast<uint32_t *>(a);
+  }
+
+  static const uint32_t *words(const FFElem<n> *a) {
+    return reinterpret_cast<const uint32_t *>(a);
+  }
+
+  static const FFSimdModulus &modulus() {
+    static const FFSimdModulus m(n);
+    return m;
+  }
+
+  static void add(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    ffSimdKernels().add(words(dst), words(src), len, modulus());
+  }
+
+  static void sub(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    ffSimdKernels().sub(words(dst), words(src), len, modulus());
+  }
+
+  static void scale(FFElem<n> *dst, const FFElem<n> &c, size_t len) {
+    ffSimdKernels().scale(words(dst), modulus().toMontgomery(c.value()), len, modulus());
+  }
+
+  static void addMul(FFElem<n> *dst, const FFElem<n> *src, const FFElem<n> &c, size_t len) {
+    ffSimdKernels().addMul(words(dst), words(src), modulus().toMontgomery(c.value()), len, modulus());
+  }
+
+  static void mul(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+    ffSimdKernels().mul(words(dst), words(src), len, modulus());
+  }
+
+  static uint64_t dot(const FFElem<n> *a, const FFElem<n> *b, size_t len) {
+    return ffSimdKernels().dot(words(a), words(b), len);
+  }
+};
+
+/* dst[i] += src[i] for i < len */
+template <uint64_t n>
+void ffAdd(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+  FFBatch<n>::add(dst, src, len);
+}
+
+/* dst[i] -= src[i] for i < len */
+template <uint64_t n>
+void ffSub(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+  FFBatch<n>::sub(dst, src, len);
+}
+
+/* dst[i] *= c for i < len */
+template <uint64_t n>
+void ffScale(FFElem<n> *dst, const FFElem<n> &c, size_t len) {
+  FFBatch<n>::scale(dst, c, len);
+}
+
+/* dst[i] += c * src[i] for i < len */
+template <uint64_t n>
+void ffAddMul(FFElem<n> *dst, const FFElem<n> *src, const FFElem<n> &c, size_t len) {
+  FFBatch<n>::addMul(dst, src, c, len);
+}
+
+/* dst[i] *= src[i] for i < len */
+template <uint64_t n>
+void ffMul(FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+  FFBatch<n>::mul(dst, src, len);
+}
+
+/*
+ * Unreduced sum of the a[i] * b[i] in a double width word, the caller makes
+ * sure that it doesn't overflow.
+ */
+template <uint64_t n>
+typename FFElem<n>::wide ffDot(const FFElem<n> *a, const FFElem<n> *b, size_t len) {
+  return FFBatch<n>::dot(a, b, len);
+}
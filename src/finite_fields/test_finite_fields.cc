@@ -1,6 +1,16 @@
 #define BOOST_TEST_MODULE TestFiniteFields
 #include <boost/test/included/unit_test.hpp>
 #include "finite_fields.h"
+#include "finite_fields_montgomery.h"
+#include "finite_fields_runtime.h"
+#include "finite_fields_extension.h"
+#include "finite_fields_simd.h"
+#include "finite_fields_log.h"
+#include "finite_fields_linalg.h"
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 
 struct FiniteFieldsFixture
@@ -133,4 +143,404 @@ BOOST_AUTO_TEST_CASE( test_inverse_4_is_4 )
   BOOST_CHECK_EQUAL(a.inverse(), a);
 }
 
+BOOST_AUTO_TEST_CASE( test_inverse_table_small_prime ) 
+{
+  FFElem<4093> unit(1);
+
+  for(int i = 1; i < 4093; i++) {
+    FFElem<4093> a(i);
+    BOOST_CHECK_EQUAL(a*a.inverse(), unit);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_inverse_extended_euclid ) 
+{
+  FFElem<65521> unit(1);
+
+  for(int i = 1; i < 65521; i += 97) {
+    FFElem<65521> a(i);
+    BOOST_CHECK_EQUAL(a*a.inverse(), unit);
+  }
+  BOOST_CHECK_EQUAL(FFElem<65521>(0).inverse(), FFElem<65521>(0));
+}
+
+BOOST_AUTO_TEST_CASE( test_word_size_depends_on_prime ) 
+{
+  BOOST_CHECK_EQUAL(sizeof(FFElem<5>), 4);
+  BOOST_CHECK_EQUAL(sizeof(FFElem<2147483647>), 4);
+  BOOST_CHECK_EQUAL(sizeof(FFElem<2305843009213693951>), 8);
+}
+
+BOOST_AUTO_TEST_CASE( test_product_above_2_16_does_not_overflow ) 
+{
+  FFElem<1000000007> a(1000000006);
+  FFElem<1000000007> b(-2);
+
+  BOOST_CHECK_EQUAL(a*a, FFElem<1000000007>(1));
+  BOOST_CHECK_EQUAL(a*b, FFElem<1000000007>(2));
+}
+
+BOOST_AUTO_TEST_CASE( test_61_bits_prime ) 
+{
+  // 2^61 - 1
+  typedef FFElem<2305843009213693951> F;
+  F a(uint64_t(1) << 60);
+  F b(uint64_t(1) << 59);
+
+  BOOST_CHECK_EQUAL(a*a, b);
+  BOOST_CHECK_EQUAL(a+a, F(1));
+  BOOST_CHECK_EQUAL(F(1)-a-a, F(0));
+  BOOST_CHECK_EQUAL(a*a.inverse(), F(1));
+  BOOST_CHECK_EQUAL(b/a, a);
+  BOOST_CHECK_EQUAL(F(-1), F(uint64_t(2305843009213693950)));
+}
+
+BOOST_AUTO_TEST_CASE( test_montgomery_matches_plain_arithmetic ) 
+{
+  for(int i = 0; i < 101; i++) {
+    for(int j = 0; j < 101; j++) {
+      MontFFElem<101> a(i);
+      MontFFElem<101> b(j);
+
+      BOOST_CHECK_EQUAL((a+b).value(), (i+j) % 101);
+      BOOST_CHECK_EQUAL((a-b).value(), (i-j+101) % 101);
+      BOOST_CHECK_EQUAL((a*b).value(), (i*j) % 101);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_montgomery_4_over_3_mod_5 ) 
+{
+  MontFFElem<5> a(4);
+  MontFFElem<5> b(3);
+
+  BOOST_CHECK_EQUAL(a/b, MontFFElem<5>(3));
+  BOOST_CHECK_EQUAL(b.inverse(), MontFFElem<5>(2));
+}
+
+BOOST_AUTO_TEST_CASE( test_montgomery_large_prime ) 
+{
+  // 2^31 - 1
+  MontFFElem<2147483647> a(2147483646u);
+  MontFFElem<2147483647> b(-3);
+
+  BOOST_CHECK_EQUAL((a*b).value(), 3u);
+  BOOST_CHECK_EQUAL((a*a.inverse()).value(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE( test_montgomery_ordering_and_to_stream ) 
+{
+  std::ostringstream oss;
+  MontFFElem<7> one(1);
+  MontFFElem<7> two(-5);
+
+  oss << two;
+
+  BOOST_CHECK(one < two);
+  BOOST_CHECK(two >= one);
+  BOOST_CHECK_EQUAL(oss.str(), "2[7]");
+}
+
+BOOST_AUTO_TEST_CASE( test_runtime_modulus_matches_compile_time ) 
+{
+  FFContextGuard guard(std::make_shared<FFContext>(101));
+
+  for(int i = 0; i < 101; i++) {
+    for(int j = 0; j < 101; j++) {
+      BOOST_CHECK_EQUAL((DynFFElem(i)+DynFFElem(j)).value(), (i+j) % 101);
+      BOOST_CHECK_EQUAL((DynFFElem(i)-DynFFElem(j)).value(), (i-j+101) % 101);
+      BOOST_CHECK_EQUAL((DynFFElem(i)*DynFFElem(j)).value(), (i*j) % 101);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_runtime_modulus_large_prime ) 
+{
+  // 2^32 - 5
+  FFContextGuard guard(std::make_shared<FFContext>(4294967291u));
+  DynFFElem a(-1);
+  DynFFElem b(uint64_t(4294967290u));
+
+  BOOST_CHECK_EQUAL(a, b);
+  BOOST_CHECK_EQUAL(a*a, DynFFElem(1));
+  BOOST_CHECK_EQUAL(DynFFElem(123456789)*DynFFElem(123456789).inverse(), DynFFElem(1));
+}
+
+BOOST_AUTO_TEST_CASE( test_runtime_modulus_nested_contexts ) 
+{
+  std::ostringstream oss;
+  FFContextGuard guard(std::make_shared<FFContext>(5));
+  {
+    FFContextGuard inner(std::make_shared<FFContext>(7));
+    BOOST_CHECK_EQUAL(DynFFElem::characteristic(), 7u);
+    BOOST_CHECK_EQUAL(DynFFElem(4)/DynFFElem(3), DynFFElem(6));
+  }
+  oss << DynFFElem(4)/DynFFElem(3);
+
+  BOOST_CHECK_EQUAL(oss.str(), "3[5]");
+}
+
+BOOST_AUTO_TEST_CASE( test_extension_field_GF4 ) 
+{
+  // GF(4) = GF(2)[a] / (a^2 + a + 1)
+  typedef ExtFFElem<2, 2> F;
+  ExtFFContextGuard<2, 2> guard(std::make_shared<ExtFFContext<2, 2>>(Poly<FFElem<2>>({1, 1, 1})));
+  F a = F::generator();
+
+  BOOST_CHECK_EQUAL(a*a, a+F(1));
+  BOOST_CHECK_EQUAL(a*a*a, F(1));
+  BOOST_CHECK_EQUAL(a.inverse(), a+F(1));
+  BOOST_CHECK_EQUAL(F(1)/a, a*a);
+}
+
+BOOST_AUTO_TEST_CASE( test_extension_field_GF27 ) 
+{
+  // GF(27) = GF(3)[a] / (a^3 + 2a + 1)
+  typedef ExtFFElem<3, 3> F;
+  ExtFFContextGuard<3, 3> guard(std::make_shared<ExtFFContext<3, 3>>(Poly<FFElem<3>>({1, 2, 0, 1})));
+  std::vector<F> elems;
+  for(int i = 0; i < 27; i++) {
+    elems.push_back(F(Poly<FFElem<3>>({i % 3, (i / 3) % 3, i / 9})));
+  }
+
+  for(int i = 1; i < 27; i++) {
+    BOOST_CHECK_EQUAL(elems[i]*elems[i].inverse(), F(1));
+    for(int j = 0; j < 27; j++) {
+      BOOST_CHECK_EQUAL((elems[i]*elems[j]).toPoly(), (elems[i].toPoly()*elems[j].toPoly()) % F::context().modulus());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_extension_field_to_stream ) 
+{
+  std::ostringstream oss;
+  typedef ExtFFElem<3, 2> F;
+  ExtFFContextGuard<3, 2> guard(std::make_shared<ExtFFContext<3, 2>>(Poly<FFElem<3>>({1, 0, 1})));
+
+  oss << F::generator() + F(-1);
+
+  BOOST_CHECK_EQUAL(oss.str(), "(2,1)[3^2]");
+}
+
+template <uint64_t n>
+void checkBatchKernels() {
+  const size_t len = 37;
+  std::vector<FFElem<n>> a, b;
+  for(size_t i = 0; i < len; i++) {
+    a.push_back(FFElem<n>(uint64_t(rand()) * rand()));
+    b.push_back(FFElem<n>(uint64_t(rand()) * rand()));
+  }
+  FFElem<n> c(uint64_t(rand()) * rand());
+  auto sum = a, diff = a, scaled = a, axpy = a, prod = a;
+
+  ffAdd(sum.data(), b.data(), len);
+  ffSub(diff.data(), b.data(), len);
+  ffScale(scaled.data(), c, len);
+  ffAddMul(axpy.data(), b.data(), c, len);
+  ffMul(prod.data(), b.data(), len);
+
+  for(size_t i = 0; i < len; i++) {
+    BOOST_CHECK_EQUAL(sum[i], a[i]+b[i]);
+    BOOST_CHECK_EQUAL(diff[i], a[i]-b[i]);
+    BOOST_CHECK_EQUAL(scaled[i], a[i]*c);
+    BOOST_CHECK_EQUAL(axpy[i], a[i]+c*b[i]);
+    BOOST_CHECK_EQUAL(prod[i], a[i]*b[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_kernels ) 
+{
+  checkBatchKernels<2>();
+  checkBatchKernels<5>();
+  checkBatchKernels<998244353>();
+  checkBatchKernels<2147483647>();
+  checkBatchKernels<2305843009213693951>();
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_kernels_all_instruction_sets ) 
+{
+  const size_t len = 21;
+  FFSimdModulus m(2147483629);
+  std::vector<uint32_t> a, b;
+  for(size_t i = 0; i < len; i++) {
+    a.push_back(2147483628 - i);
+    b.push_back(i * 104729);
+  }
+  uint32_t c = m.toMontgomery(123456789);
+
+  std::vector<FFSimdKernels> kernels = {ffSelectSimdKernels()};
+  kernels.push_back(FFSimdKernels{ffAddScalar, ffSubScalar, ffScaleScalar, ffAddMulScalar, ffMulScalar, ffDotScalar});
+#ifdef FF_SIMD_X86
+  if(__builtin_cpu_supports("sse4.1")) {
+    kernels.push_back(FFSimdKernels{ffAddSse4, ffSubSse4, ffScaleSse4, ffAddMulSse4, ffMulSse4, ffDotSse4});
+  }
+#endif
+  for(auto k = kernels.begin(); k != kernels.end(); k++) {
+    auto sum = a, diff = a, scaled = a, axpy = a, prod = a;
+    k->add(sum.data(), b.data(), len, m);
+    k->sub(diff.data(), b.data(), len, m);
+    k->scale(scaled.data(), c, len, m);
+    k->addMul(axpy.data(), b.data(), c, len, m);
+    k->mul(prod.data(), b.data(), len, m);
+    for(size_t i = 0; i < len; i++) {
+      BOOST_CHECK_EQUAL(sum[i], (uint64_t(a[i]) + b[i]) % m.p);
+      BOOST_CHECK_EQUAL(diff[i], (uint64_t(a[i]) + m.p - b[i]) % m.p);
+      BOOST_CHECK_EQUAL(scaled[i], uint64_t(a[i]) * 123456789 % m.p);
+      BOOST_CHECK_EQUAL(axpy[i], (uint64_t(a[i]) + uint64_t(b[i]) * 123456789) % m.p);
+      BOOST_CHECK_EQUAL(prod[i], uint64_t(a[i]) * b[i] % m.p);
+    }
+    // Only a few products of 31 bits numbers fit in 64 bits
+    for(size_t i = 0; i + 3 <= len; i += 3) {
+      uint64_t dot = uint64_t(a[i]) * b[i] + uint64_t(a[i+1]) * b[i+1] + uint64_t(a[i+2]) * b[i+2];
+      BOOST_CHECK_EQUAL(k->dot(a.data() + i, b.data() + i, 3), dot);
+    }
+    uint32_t ones[32];
+    std::fill(ones, ones + 32, 1);
+    BOOST_CHECK_EQUAL(k->dot(ones, a.data(), 29), std::accumulate(a.begin(), a.begin() + 29, uint64_t(0)));
+  }
+}
+
+template <uint64_t n>
+void checkBatchInverse() {
+  typedef FFElem<n> F;
+  std::vector<F> v;
+  for(int i = 0; i < 100; i++) {
+    v.push_back(F(i * 7919));
+  }
+  auto inv = v;
+  batchInverse(inv.data(), inv.size());
+  for(size_t i = 0; i < v.size(); i++) {
+    BOOST_CHECK_EQUAL(inv[i], v[i].inverse());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_inverse ) 
+{
+  // Contains zeros, which are left as is
+  checkBatchInverse<5>();
+  checkBatchInverse<65521>();
+  checkBatchInverse<2305843009213693951>();
+
+  batchInverse(static_cast<FFElem<5> *>(nullptr), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_log_tables_match_plain_arithmetic ) 
+{
+  for(int i = 0; i < 101; i++) {
+    for(int j = 0; j < 101; j++) {
+      LogFFElem<101> a(i);
+      LogFFElem<101> b(j);
+
+      BOOST_CHECK_EQUAL((a+b).value(), FFElem<101>(i+j).value());
+      BOOST_CHECK_EQUAL((a-b).value(), FFElem<101>(i-j).value());
+      BOOST_CHECK_EQUAL((a*b).value(), FFElem<101>(i*j).value());
+      BOOST_CHECK_EQUAL((a/b).value(), (FFElem<101>(i)/FFElem<101>(j)).value());
+    }
+    BOOST_CHECK_EQUAL(LogFFElem<101>(i).inverse().value(), FFElem<101>(i).inverse().value());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_log_tables_small_and_large_primes ) 
+{
+  LogFFElem<2> one(1);
+  BOOST_CHECK_EQUAL(one*one, one);
+  BOOST_CHECK_EQUAL(one.inverse(), one);
+  BOOST_CHECK_EQUAL(one+one, LogFFElem<2>(0));
+
+  LogFFElem<65521> a(65520u);
+  LogFFElem<65521> b(-3);
+  BOOST_CHECK_EQUAL((a*b).value(), 3u);
+  BOOST_CHECK_EQUAL(a*a.inverse(), LogFFElem<65521>(1));
+  BOOST_CHECK_EQUAL(b/a, LogFFElem<65521>(3));
+  BOOST_CHECK_EQUAL((LogFFElem<65521>(12345)*LogFFElem<65521>(54321)).value(), (12345u*54321u) % 65521);
+}
+
+BOOST_AUTO_TEST_CASE( test_log_tables_composite ) 
+{
+  // No generator: the construction reports it instead of looping forever
+  FFLogTables<4> t4;
+  FFLogTables<15> t15;
+  BOOST_CHECK_EQUAL(t4.exp_[0], 1);
+  BOOST_CHECK_EQUAL(t15.exp_[0], 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_log_tables_to_stream ) 
+{
+  std::ostringstream oss;
+  oss << LogFFElem<7>(-5);
+
+  BOOST_CHECK_EQUAL(oss.str(), "2[7]");
+}
+
+/* Unblocked Gauss-Jordan elimination, for comparison */
+template <uint64_t n>
+void naiveRowReduce(std::vector<FFElem<n>> &a, size_t rows, size_t cols) {
+  std::vector<bool> used(rows, false);
+  for(size_t c = 0; c < cols; c++) {
+    size_t p = 0;
+    while(p < rows && (used[p] || a[p*cols+c] == FFElem<n>(0))) {
+      p++;
+    }
+    if(p == rows) {
+      continue;
+    }
+    used[p] = true;
+    FFElem<n> inverse = a[p*cols+c].inverse();
+    for(size_t j = 0; j < cols; j++) {
+      a[p*cols+j] *= inverse;
+    }
+    for(size_t r = 0; r < rows; r++) {
+      FFElem<n> x = a[r*cols+c];
+      for(size_t j = 0; r != p && j < cols; j++) {
+        a[r*cols+j] -= x * a[p*cols+j];
+      }
+    }
+  }
+}
+
+/* rows x cols matrix of rank at most rank */
+template <uint64_t n>
+std::vector<FFElem<n>> lowRankMatrix(size_t rows, size_t cols, size_t rank) {
+  std::vector<FFElem<n>> l(rows*rank), r(rank*cols), a(rows*cols);
+  for(auto &x : l) x = FFElem<n>(static_cast<uint64_t>(rand()));
+  for(auto &x : r) x = FFElem<n>(static_cast<uint64_t>(rand()));
+  for(size_t i = 0; i < rows; i++) {
+    for(size_t k = 0; k < rank; k++) {
+      for(size_t j = 0; j < cols; j++) {
+        a[i*cols+j] += l[i*rank+k] * r[k*cols+j];
+      }
+    }
+  }
+  return a;
+}
+
+template <uint64_t n>
+void checkRowReduce(size_t rows, size_t cols, size_t rank) {
+  std::vector<FFElem<n>> a = lowRankMatrix<n>(rows, cols, rank);
+  std::vector<FFElem<n>> blocked = a, naive = a;
+  ffRowReduce(blocked.data(), rows, cols);
+  naiveRowReduce(naive, rows, cols);
+  BOOST_CHECK(blocked == naive);
+
+  auto kernel = ffNullspace(a, rows, cols);
+  BOOST_CHECK_EQUAL(kernel.size(), cols - std::min(rank, std::min(rows, cols)));
+  for(auto &v : kernel) {
+    for(size_t i = 0; i < rows; i++) {
+      FFElem<n> x(0);
+      for(size_t j = 0; j < cols; j++) {
+        x += a[i*cols+j] * v[j];
+      }
+      BOOST_CHECK_EQUAL(x, FFElem<n>(0));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_row_reduce_and_nullspace ) 
+{
+  checkRowReduce<5>(70, 90, 50);
+  checkRowReduce<65521>(100, 100, 80);
+  checkRowReduce<65521>(40, 130, 40);
+  checkRowReduce<2305843009213693951>(50, 45, 33);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
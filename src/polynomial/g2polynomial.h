@@ -10,6 +10,17 @@
 #include <utility>
 #include <cmath>
 #include <bitset>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include "thread_pool.h"
+#include "random_generator.h"
+
+// Parallel products split the terms of their first operand down to this
+// number of terms.
+#ifndef G2POLY_PARALLEL_MUL_GRAIN
+#define G2POLY_PARALLEL_MUL_GRAIN 1024
+#endif
 
 class G2Poly {
   public:
@@ -27,10 +38,13 @@ class G2Poly {
     G2Poly squareFreePart(uint64_t p) const;
     std::vector<std::pair<G2Poly, uint64_t>> squareFreeFactors(uint64_t p) const;
     std::vector<G2Poly> distinctDegreeFactors(uint64_t p) const;
+    std::vector<G2Poly> distinctDegreeFactors(uint64_t p, ThreadPool &pool) const;
     G2Poly cantorZassenhaus(uint64_t p) const;
     G2Poly knuth(uint64_t p) const;
     G2Poly mceliece(uint64_t p) const;
     G2Poly equalDegreeFactorize(uint64_t p, uint64_t i) const;
+    G2Poly equalDegreeFactorize(uint64_t p, uint64_t i, ThreadPool &pool, size_t trials = 0) const;
+    std::vector<std::pair<G2Poly, uint64_t>> factor(uint64_t p) const;
 
     G2Poly& operator-=(const G2Poly &p);
     G2Poly& operator+=(const G2Poly &p);
@@ -38,6 +52,7 @@ class G2Poly {
 
     static G2Poly Xn(uint64_t n);
     static G2Poly Rand(uint64_t n);
+    static G2Poly Rand(uint64_t n, RandomGenerator &rng);
 
   // TODO: make this protected by removing all direct usage in non friend non member methods
   //protected:
@@ -196,11 +211,21 @@ G2Poly G2Poly::Xn(uint64_t n) {
   return p;
 }
 
+/* Polynom of degree < n with random coefficients from the generator of the thread */
 G2Poly G2Poly::Rand(uint64_t n) {
+  return Rand(n, RandomGenerator::current());
+}
+
+/* Drawn by whole words of 64 coefficients, highest first */
+G2Poly G2Poly::Rand(uint64_t n, RandomGenerator &rng) {
   G2Poly p;
-  for(uint64_t i = n; i > 0; i--) {
-    if(rand() & 1) {
-      p.coeffs_.push_back(i-1);
+  for(uint64_t i = (n + 63) / 64; i > 0; i--) {
+    uint64_t word = rng.next();
+    uint64_t bits = std::min(n - 64*(i-1), uint64_t(64));
+    for(uint64_t j = bits; j > 0; j--) {
+      if((word >> (j-1)) & 1) {
+        p.coeffs_.push_back(64*(i-1) + j-1);
+      }
     }
   }
   return p;
@@ -386,9 +411,12 @@ std::vector<std::pair<G2Poly, uint64_t>> G2Poly::squareFreeFactors(uint64_t p) c
     }
     if (c != unit) {
       //std::cout << "Unpowering " << c << " with degree " << p << std::endl;
-      c = c.unpower(p);
-      //std::cout << "Adding(2) " << c << " with degree " << p << std::endl;
-      result.push_back(std::make_pair(c, p));
+      // c is a p-th power, whose root can have several square free factors
+      auto root = c.unpower(p).squareFreeFactors(p);
+      for(auto it = root.begin(); it != root.end(); it++) {
+        //std::cout << "Adding(2) " << it->first << " with degree " << it->second*p << std::endl;
+        result.push_back(std::make_pair(it->first, it->second*p));
+      }
       return result;
     }
     else {
@@ -547,3 +575,256 @@ G2Poly G2Poly::mceliece(uint64_t p) const {
   std::cerr << "Oups, McEliece didn't work !!!" << std::endl;
   return *this;
 }
+
+/*
+ * One trial of the split of f, square free with all its irreducible factors of
+ * degree d, with the trace map a + a^2 + ... + a^(2^(d-1)) mod f of a polynom
+ * a drawn from rng: a non trivial factor of f, or a null polynom if it doesn't
+ * split f or if firstSuccess gets below trial (the index of this trial)
+ * meanwhile.
+ */
+G2Poly equalDegreeTrial(const G2Poly &f, uint64_t d, RandomGenerator &rng, const std::atomic<size_t> *firstSuccess = nullptr, size_t trial = 0) {
+  auto a = G2Poly::Rand(f.degree(), rng);
+  auto b = a;
+  auto t = a;
+  for(uint64_t i = 1; i < d; i++) {
+    if(firstSuccess && firstSuccess->load(std::memory_order_relaxed) < trial) {
+      return G2Poly();
+    }
+    t = (t*t) % f;
+    b += t;
+  }
+  if(b.null()) {
+    return G2Poly();
+  }
+  auto g = gcd(f, b);
+  if(g == G2Poly::Xn(0)) {
+    return G2Poly();
+  }
+  return g;
+}
+
+/*
+ * Appends to factors the irreducible factors of f, square free with all its
+ * irreducible factors of degree d, splitting it recursively.
+ */
+void equalDegreeFactors(const G2Poly &f, uint64_t d, std::vector<G2Poly> &factors) {
+  if(f.degree() <= static_cast<int64_t>(d)) {
+    factors.push_back(f);
+    return;
+  }
+  while(true) {
+    auto g = equalDegreeTrial(f, d, RandomGenerator::current());
+    if(!g.null()) {
+      equalDegreeFactors(g, d, factors);
+      equalDegreeFactors(f / g, d, factors);
+      return;
+    }
+  }
+}
+
+/*
+ * Complete factorization: the irreducible factors with their multiplicities.
+ * The distinct degree factorization of each square free factor keeps
+ * X^(2^d) mod the part left to factor, each one being obtained from the
+ * previous one by a squaring.
+ */
+std::vector<std::pair<G2Poly, uint64_t>> G2Poly::factor(uint64_t p) const {
+  std::vector<std::pair<G2Poly, uint64_t>> result;
+  if(degree() <= 0) {
+    return result;
+  }
+  auto unit = G2Poly::Xn(0);
+  auto x = G2Poly::Xn(1);
+  auto sff = squareFreeFactors(p);
+  for(auto it = sff.begin(); it != sff.end(); it++) {
+    std::vector<G2Poly> factors;
+    auto rest = it->first;
+    auto h = x % rest;
+    for(int64_t d = 1; 2*d <= rest.degree(); d++) {
+      h = (h*h) % rest;
+      auto s = h - x;
+      auto g = s.null() ? rest : gcd(rest, s);
+      if(g != unit) {
+        equalDegreeFactors(g, d, factors);
+        rest = rest / g;
+        h = h % rest;
+      }
+    }
+    if(rest.degree() > 0) {
+      factors.push_back(rest);
+    }
+    for(auto jt = factors.begin(); jt != factors.end(); jt++) {
+      result.push_back(std::make_pair(*jt, it->second));
+    }
+  }
+  return result;
+}
+
+/*
+ * Non trivial factor of f, whose irreducible factors all have degree d (or
+ * itself if it has only one), with trials tasks of the pool (as many as its
+ * workers if 0) trying random polynoms at the same time. The k-th trial draws
+ * its polynom from the k-th stream split from a generator seeded by the one of
+ * the thread, and the factor of the first successful trial is returned
+ * whatever the scheduling, the trials after it stopping at their next check
+ * of firstSuccess. The trials use the trace map, as in factor.
+ */
+G2Poly G2Poly::equalDegreeFactorize(uint64_t p, uint64_t d, ThreadPool &pool, size_t trials) const {
+  if(degree() <= static_cast<int64_t>(d)) {
+    return *this;
+  }
+  if(trials == 0) {
+    trials = std::max(pool.size(), size_t(1));
+  }
+  RandomGenerator streams(RandomGenerator::current().next());
+  std::atomic<size_t> firstSuccess(std::numeric_limits<size_t>::max());
+  std::mutex mutex;
+  G2Poly result;
+  TaskGroup group(pool);
+  for(size_t i = 0; i < trials; i++) {
+    group.run([&, i]() {
+      for(size_t k = i; k < firstSuccess.load(std::memory_order_relaxed); k += trials) {
+        auto rng = streams.split(k);
+        auto g = equalDegreeTrial(*this, d, rng, &firstSuccess, k);
+        if(!g.null()) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if(k < firstSuccess.load()) {
+            result = g;
+            firstSuccess.store(k);
+          }
+        }
+      }
+    });
+  }
+  group.wait();
+  return result;
+}
+
+/*
+ * Factorizations (see factor) of polys[0], ..., polys[count-1], in the same
+ * order. Each polynom is a task of the pool, idle workers stealing the
+ * remaining ones from the others. The i-th one uses the i-th stream split
+ * from a generator seeded by the one of the thread, so that the factors come
+ * in the same order whatever the scheduling.
+ */
+std::vector<std::vector<std::pair<G2Poly, uint64_t>>> factorBatch(const G2Poly *polys, size_t count, uint64_t p, ThreadPool &pool = ThreadPool::instance()) {
+  std::vector<std::vector<std::pair<G2Poly, uint64_t>>> results(count);
+  RandomGenerator streams(RandomGenerator::current().next());
+  parallelFor(pool, 0, count, 1, [&](size_t i) {
+    auto rng = streams.split(i);
+    RandomGeneratorGuard guard(rng);
+    results[i] = polys[i].factor(p);
+  });
+  return results;
+}
+
+std::vector<std::vector<std::pair<G2Poly, uint64_t>>> factorBatch(const std::vector<G2Poly> &polys, uint64_t p, ThreadPool &pool = ThreadPool::instance()) {
+  return factorBatch(polys.data(), polys.size(), p, pool);
+}
+
+/*
+ * a * b computed with the tasks of the pool: the terms of a are split in
+ * halves down to G2POLY_PARALLEL_MUL_GRAIN terms, whose products by b are
+ * added.
+ */
+G2Poly parallelMul(const G2Poly &a, const G2Poly &b, ThreadPool &pool = ThreadPool::instance()) {
+  if(a.coeffs_.size() < size_t(std::max(G2POLY_PARALLEL_MUL_GRAIN, 2))) {
+    return a * b;
+  }
+  size_t h = a.coeffs_.size() / 2;
+  G2Poly high, low, highProduct, lowProduct;
+  high.coeffs_.assign(a.coeffs_.begin(), a.coeffs_.begin() + h);
+  low.coeffs_.assign(a.coeffs_.begin() + h, a.coeffs_.end());
+  TaskGroup group(pool);
+  group.run([&]() { highProduct = parallelMul(high, b, pool); });
+  lowProduct = parallelMul(low, b, pool);
+  group.wait();
+  return highProduct + lowProduct;
+}
+
+/*
+ * distinctDegreeFactors computed in parallel. The degrees up to deg(f)/2 are
+ * grouped in intervals of l consecutive degrees: with the baby steps
+ * X^(2^i) mod f for i <= l and the giant steps X^(2^(l(j+1))) mod f, all the
+ * irreducible factors of degree in the j-th interval divide the product of the
+ * X^(2^(l(j+1))) - X^(2^i) for i < l. These products and their gcds with f, one
+ * per interval, run as tasks of the pool, and so does the split of each
+ * interval into exact degrees. The i-th factor is the product of the
+ * irreducible factors of degree i+1, unit below the largest degree and null
+ * above it.
+ */
+std::vector<G2Poly> G2Poly::distinctDegreeFactors(uint64_t p, ThreadPool &pool) const {
+  std::vector<G2Poly> g;
+  auto f = this->squareFreePart(p);
+  int64_t n = f.degree();
+  g.resize(std::max(n, static_cast<int64_t>(0)));
+  if(n <= 0) {
+    return g;
+  }
+  auto unit = G2Poly::Xn(0);
+  int64_t l = 1;
+  while(2*l*l < n) {
+    l++;
+  }
+  int64_t intervals = 0;
+  while(n >= 2*(l*intervals+1)) {
+    intervals++;
+  }
+  // Baby steps
+  std::vector<G2Poly> baby(l+1);
+  baby[0] = G2Poly::Xn(1) % f;
+  for(int64_t i = 1; i <= l; i++) {
+    baby[i] = (baby[i-1]*baby[i-1]) % f;
+  }
+  // Giant steps
+  std::vector<G2Poly> giant(intervals);
+  auto h = baby[l];
+  for(int64_t j = 0; j < intervals; j++) {
+    for(int64_t i = 0; j > 0 && i < l; i++) {
+      h = (h*h) % f;
+    }
+    giant[j] = h;
+  }
+  std::vector<G2Poly> found(intervals);
+  parallelFor(pool, 0, intervals, 1, [&](size_t j) {
+    auto interval = unit;
+    for(int64_t i = 0; i < l && !interval.null(); i++) {
+      interval = (interval * (giant[j] - baby[i])) % f;
+    }
+    found[j] = interval.null() ? f : gcd(f, interval);
+  });
+  // Factors of degree in an earlier interval also divide found[j]
+  auto rest = f;
+  for(int64_t j = 0; j < intervals; j++) {
+    found[j] = gcd(rest, found[j]);
+    if(found[j] != unit) {
+      rest = rest / found[j];
+    }
+  }
+  parallelFor(pool, 0, intervals, 1, [&](size_t j) {
+    auto c = found[j];
+    for(int64_t i = l-1; i >= 0 && c.degree() > 0; i--) {
+      auto s = (giant[j] - baby[i]) % c;
+      auto d = s.null() ? c : gcd(c, s);
+      if(d != unit) {
+        g[l*(j+1)-i-1] = d;
+        c = c / d;
+      }
+    }
+  });
+  // What is left is irreducible
+  if(rest.degree() > 0) {
+    g[rest.degree()-1] = rest;
+  }
+  int64_t largest = n;
+  while(largest > 0 && g[largest-1].null()) {
+    largest--;
+  }
+  for(int64_t i = 0; i < largest; i++) {
+    if(g[i].null()) {
+      g[i] = unit;
+    }
+  }
+  return g;
+}
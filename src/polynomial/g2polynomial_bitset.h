@@ -10,6 +10,11 @@
 #include <algorithm>
 #include <cmath>
 #include <bitset>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include "thread_pool.h"
+#include "random_generator.h"
 
 // If changing MAX_SIZE then derivationMask must only be changed
 //#define MAX_SIZE 512
@@ -18,6 +23,11 @@
 
 static std::bitset<MAX_SIZE> derivationMask("1010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010", 1024, '1', '0');
 
+// Parallel products split their operands down to this degree.
+#ifndef G2POLY_PARALLEL_MUL_GRAIN
+#define G2POLY_PARALLEL_MUL_GRAIN 256
+#endif
+
 class G2Poly {
   public:
     G2Poly();
@@ -33,10 +43,13 @@ class G2Poly {
     G2Poly squareFreePart(uint64_t p) const;
     std::vector<std::pair<G2Poly, uint64_t>> squareFreeFactors(uint64_t p) const;
     std::vector<G2Poly> distinctDegreeFactors(uint64_t p) const;
+    std::vector<G2Poly> distinctDegreeFactors(uint64_t p, ThreadPool &pool) const;
     G2Poly cantorZassenhaus(uint64_t p) const;
     G2Poly knuth(uint64_t p) const;
     G2Poly mceliece(uint64_t p) const;
     G2Poly equalDegreeFactorize(uint64_t p, uint64_t i) const;
+    G2Poly equalDegreeFactorize(uint64_t p, uint64_t i, ThreadPool &pool, size_t trials = 0) const;
+    std::vector<std::pair<G2Poly, uint64_t>> factor(uint64_t p) const;
 
     G2Poly& operator-=(const G2Poly &p);
     G2Poly& operator+=(const G2Poly &p);
@@ -44,6 +57,7 @@ class G2Poly {
 
     static G2Poly Xn(uint64_t n);
     static G2Poly Rand(uint64_t n);
+    static G2Poly Rand(uint64_t n, RandomGenerator &rng);
 
   // TODO: make this protected by removing all direct usage in non friend non member methods
   //protected:
@@ -164,14 +178,25 @@ G2Poly G2Poly::Xn(uint64_t n) {
   return p;
 }
 
+/* Polynom of degree < n with random coefficients from the generator of the thread */
 G2Poly G2Poly::Rand(uint64_t n) {
+  return Rand(n, RandomGenerator::current());
+}
+
+/* Filled by whole words of 64 coefficients, highest first */
+G2Poly G2Poly::Rand(uint64_t n, RandomGenerator &rng) {
   G2Poly p;
-  for(uint64_t i = 0; i < n; i++) {
-    if(rand() & 1) {
-      p.coeffs_[i] = true;
-      p.degree_ = i;
+  n = std::min(n, uint64_t(MAX_SIZE));
+  for(uint64_t i = (n + 63) / 64; i > 0; i--) {
+    uint64_t word = rng.next();
+    uint64_t bits = n - 64*(i-1);
+    if(bits < 64) {
+      word &= (uint64_t(1) << bits) - 1;
     }
+    p.coeffs_ <<= 64;
+    p.coeffs_ |= std::bitset<MAX_SIZE>(word);
   }
+  p.simplify(n > 0 ? n-1 : 0);
   return p;
 }
 
@@ -308,9 +333,12 @@ std::vector<std::pair<G2Poly, uint64_t>> G2Poly::squareFreeFactors(uint64_t p) c
     }
     if (c != unit) {
       //std::cerr << "Unpowering " << c << " with degree " << p << std::endl;
-      c = c.unpower(p);
-      //std::cerr << "Adding(2) " << c << " with degree " << p << std::endl;
-      result.push_back(std::make_pair(c, p));
+      // c is a p-th power, whose root can have several square free factors
+      auto root = c.unpower(p).squareFreeFactors(p);
+      for(auto it = root.begin(); it != root.end(); it++) {
+        //std::cerr << "Adding(2) " << it->first << " with degree " << it->second*p << std::endl;
+        result.push_back(std::make_pair(it->first, it->second*p));
+      }
       return result;
     }
     else {
@@ -469,3 +497,291 @@ G2Poly G2Poly::mceliece(uint64_t p) const {
   std::cerr << "Oups, McEliece didn't work !!!" << std::endl;
   return *this;
 }
+
+/*
+ * One trial of the split of f, square free with all its irreducible factors of
+ * degree d, with the trace map a + a^2 + ... + a^(2^(d-1)) mod f of a polynom
+ * a drawn from rng: a non trivial factor of f, or a null polynom if it doesn't
+ * split f or if firstSuccess gets below trial (the index of this trial)
+ * meanwhile.
+ */
+G2Poly equalDegreeTrial(const G2Poly &f, uint64_t d, RandomGenerator &rng, const std::atomic<size_t> *firstSuccess = nullptr, size_t trial = 0) {
+  auto a = G2Poly::Rand(f.degree(), rng);
+  auto b = a;
+  auto t = a;
+  for(uint64_t i = 1; i < d; i++) {
+    if(firstSuccess && firstSuccess->load(std::memory_order_relaxed) < trial) {
+      return G2Poly();
+    }
+    t = (t*t) % f;
+    b += t;
+  }
+  if(b.null()) {
+    return G2Poly();
+  }
+  auto g = gcd(f, b);
+  if(g == G2Poly::Xn(0)) {
+    return G2Poly();
+  }
+  return g;
+}
+
+/*
+ * Appends to factors the irreducible factors of f, square free with all its
+ * irreducible factors of degree d, splitting it recursively.
+ */
+void equalDegreeFactors(const G2Poly &f, uint64_t d, std::vector<G2Poly> &factors) {
+  if(f.degree() <= static_cast<int64_t>(d)) {
+    factors.push_back(f);
+    return;
+  }
+  while(true) {
+    auto g = equalDegreeTrial(f, d, RandomGenerator::current());
+    if(!g.null()) {
+      equalDegreeFactors(g, d, factors);
+      equalDegreeFactors(f / g, d, factors);
+      return;
+    }
+  }
+}
+
+/*
+ * Complete factorization: the irreducible factors with their multiplicities.
+ * The distinct degree factorization of each square free factor keeps
+ * X^(2^d) mod the part left to factor, each one being obtained from the
+ * previous one by a squaring.
+ */
+std::vector<std::pair<G2Poly, uint64_t>> G2Poly::factor(uint64_t p) const {
+  std::vector<std::pair<G2Poly, uint64_t>> result;
+  if(degree() <= 0) {
+    return result;
+  }
+  auto unit = G2Poly::Xn(0);
+  auto x = G2Poly::Xn(1);
+  auto sff = squareFreeFactors(p);
+  for(auto it = sff.begin(); it != sff.end(); it++) {
+    std::vector<G2Poly> factors;
+    auto rest = it->first;
+    auto h = x % rest;
+    for(int64_t d = 1; 2*d <= rest.degree(); d++) {
+      h = (h*h) % rest;
+      auto s = h - x;
+      auto g = s.null() ? rest : gcd(rest, s);
+      if(g != unit) {
+        equalDegreeFactors(g, d, factors);
+        rest = rest / g;
+        h = h % rest;
+      }
+    }
+    if(rest.degree() > 0) {
+      factors.push_back(rest);
+    }
+    for(auto jt = factors.begin(); jt != factors.end(); jt++) {
+      result.push_back(std::make_pair(*jt, it->second));
+    }
+  }
+  return result;
+}
+
+/*
+ * Non trivial factor of f, whose irreducible factors all have degree d (or
+ * itself if it has only one), with trials tasks of the pool (as many as its
+ * workers if 0) trying random polynoms at the same time. The k-th trial draws
+ * its polynom from the k-th stream split from a generator seeded by the one of
+ * the thread, and the factor of the first successful trial is returned
+ * whatever the scheduling, the trials after it stopping at their next check
+ * of firstSuccess. The trials use the trace map, as in factor.
+ */
+G2Poly G2Poly::equalDegreeFactorize(uint64_t p, uint64_t d, ThreadPool &pool, size_t trials) const {
+  if(degree() <= static_cast<int64_t>(d)) {
+    return *this;
+  }
+  if(trials == 0) {
+    trials = std::max(pool.size(), size_t(1));
+  }
+  RandomGenerator streams(RandomGenerator::current().next());
+  std::atomic<size_t> firstSuccess(std::numeric_limits<size_t>::max());
+  std::mutex mutex;
+  G2Poly result;
+  TaskGroup group(pool);
+  for(size_t i = 0; i < trials; i++) {
+    group.run([&, i]() {
+      for(size_t k = i; k < firstSuccess.load(std::memory_order_relaxed); k += trials) {
+        auto rng = streams.split(k);
+        auto g = equalDegreeTrial(*this, d, rng, &firstSuccess, k);
+        if(!g.null()) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if(k < firstSuccess.load()) {
+            result = g;
+            firstSuccess.store(k);
+          }
+        }
+      }
+    });
+  }
+  group.wait();
+  return result;
+}
+
+/*
+ * Factorizations (see factor) of polys[0], ..., polys[count-1], in the same
+ * order. Each polynom is a task of the pool, idle workers stealing the
+ * remaining ones from the others. The i-th one uses the i-th stream split
+ * from a generator seeded by the one of the thread, so that the factors come
+ * in the same order whatever the scheduling.
+ */
+std::vector<std::vector<std::pair<G2Poly, uint64_t>>> factorBatch(const G2Poly *polys, size_t count, uint64_t p, ThreadPool &pool = ThreadPool::instance()) {
+  std::vector<std::vector<std::pair<G2Poly, uint64_t>>> results(count);
+  RandomGenerator streams(RandomGenerator::current().next());
+  parallelFor(pool, 0, count, 1, [&](size_t i) {
+    auto rng = streams.split(i);
+    RandomGeneratorGuard guard(rng);
+    results[i] = polys[i].factor(p);
+  });
+  return results;
+}
+
+std::vector<std::vector<std::pair<G2Poly, uint64_t>>> factorBatch(const std::vector<G2Poly> &polys, uint64_t p, ThreadPool &pool = ThreadPool::instance()) {
+  return factorBatch(polys.data(), polys.size(), p, pool);
+}
+
+/*
+ * a * b computed with the tasks of the pool, splitting both operands as in
+ * Karatsuba: with a = a0 + X^h a1 and b = b0 + X^h b1, the products a0 b0,
+ * a1 b1 and (a0 + a1)(b0 + b1) run as tasks down to G2POLY_PARALLEL_MUL_GRAIN
+ * coefficients. When b is less than half as long as a, the halves of a are
+ * multiplied by b instead.
+ */
+G2Poly parallelMul(const G2Poly &a, const G2Poly &b, ThreadPool &pool = ThreadPool::instance()) {
+  if(a.degree() < b.degree()) {
+    return parallelMul(b, a, pool);
+  }
+  if(b.degree() < std::max(G2POLY_PARALLEL_MUL_GRAIN, 2)) {
+    return a * b;
+  }
+  int64_t h = (a.degree() + 1) / 2;
+  std::bitset<MAX_SIZE> mask;
+  mask.set();
+  mask >>= MAX_SIZE - h;
+  // c = low + X^h high
+  auto split = [&](const G2Poly &c, G2Poly &low, G2Poly &high) {
+    high = c;
+    high.coeffs_ >>= h;
+    high.simplify(std::max(c.degree() - h, static_cast<int64_t>(0)));
+    low = c;
+    low.coeffs_ &= mask;
+    low.simplify(h);
+  };
+  auto timesXn = [](G2Poly c, int64_t n) {
+    if(!c.null()) {
+      c.coeffs_ <<= n;
+      c.degree_ += n;
+    }
+    return c;
+  };
+  G2Poly a0, a1;
+  split(a, a0, a1);
+  TaskGroup group(pool);
+  if(a.degree() + 1 >= 2*(b.degree() + 1)) {
+    G2Poly lowProduct, highProduct;
+    group.run([&]() { highProduct = parallelMul(a1, b, pool); });
+    lowProduct = parallelMul(a0, b, pool);
+    group.wait();
+    return lowProduct + timesXn(highProduct, h);
+  }
+  G2Poly b0, b1, z0, z1, z2;
+  split(b, b0, b1);
+  group.run([&]() { z0 = parallelMul(a0, b0, pool); });
+  group.run([&]() { z2 = parallelMul(a1, b1, pool); });
+  z1 = parallelMul(a0 + a1, b0 + b1, pool);
+  group.wait();
+  z1 -= z0;
+  z1 -= z2;
+  return z0 + timesXn(z1, h) + timesXn(z2, 2*h);
+}
+
+/*
+ * distinctDegreeFactors computed in parallel. The degrees up to deg(f)/2 are
+ * grouped in intervals of l consecutive degrees: with the baby steps
+ * X^(2^i) mod f for i <= l and the giant steps X^(2^(l(j+1))) mod f, all the
+ * irreducible factors of degree in the j-th interval divide the product of the
+ * X^(2^(l(j+1))) - X^(2^i) for i < l. These products and their gcds with f, one
+ * per interval, run as tasks of the pool, and so does the split of each
+ * interval into exact degrees. The i-th factor is the product of the
+ * irreducible factors of degree i+1, unit below the largest degree and null
+ * above it.
+ */
+std::vector<G2Poly> G2Poly::distinctDegreeFactors(uint64_t p, ThreadPool &pool) const {
+  std::vector<G2Poly> g;
+  auto f = this->squareFreePart(p);
+  int64_t n = f.degree();
+  g.resize(std::max(n, static_cast<int64_t>(0)));
+  if(n <= 0) {
+    return g;
+  }
+  auto unit = G2Poly::Xn(0);
+  int64_t l = 1;
+  while(2*l*l < n) {
+    l++;
+  }
+  int64_t intervals = 0;
+  while(n >= 2*(l*intervals+1)) {
+    intervals++;
+  }
+  // Baby steps
+  std::vector<G2Poly> baby(l+1);
+  baby[0] = G2Poly::Xn(1) % f;
+  for(int64_t i = 1; i <= l; i++) {
+    baby[i] = (baby[i-1]*baby[i-1]) % f;
+  }
+  // Giant steps
+  std::vector<G2Poly> giant(intervals);
+  auto h = baby[l];
+  for(int64_t j = 0; j < intervals; j++) {
+    for(int64_t i = 0; j > 0 && i < l; i++) {
+      h = (h*h) % f;
+    }
+    giant[j] = h;
+  }
+  std::vector<G2Poly> found(intervals);
+  parallelFor(pool, 0, intervals, 1, [&](size_t j) {
+    auto interval = unit;
+    for(int64_t i = 0; i < l && !interval.null(); i++) {
+      interval = (interval * (giant[j] - baby[i])) % f;
+    }
+    found[j] = interval.null() ? f : gcd(f, interval);
+  });
+  // Factors of degree in an earlier interval also divide found[j]
+  auto rest = f;
+  for(int64_t j = 0; j < intervals; j++) {
+    found[j] = gcd(rest, found[j]);
+    if(found[j] != unit) {
+      rest = rest / found[j];
+    }
+  }
+  parallelFor(pool, 0, intervals, 1, [&](size_t j) {
+    auto c = found[j];
+    for(int64_t i = l-1; i >= 0 && c.degree() > 0; i--) {
+      auto s = (giant[j] - baby[i]) % c;
+      auto d = s.null() ? c : gcd(c, s);
+      if(d != unit) {
+        g[l*(j+1)-i-1] = d;
+        c = c / d;
+      }
+    }
+  });
+  // What is left is irreducible
+  if(rest.degree() > 0) {
+    g[rest.degree()-1] = rest;
+  }
+  int64_t largest = n;
+  while(largest > 0 && g[largest-1].null()) {
+    largest--;
+  }
+  for(int64_t i = 0; i < largest; i++) {
+    if(g[i].null()) {
+      g[i] = unit;
+    }
+  }
+  return g;
+}
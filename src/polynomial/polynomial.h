@@ -5,6 +5,272 @@
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include "polynomial_fft.h"
+#include "thread_pool.h"
+#include "random_generator.h"
+
+/*
+ * Coefficient kernels used by Poly<T> for its arithmetic. The PolyKernel tag
+ * being declared in the global namespace, argument dependent lookup finds
+ * overloads of these functions declared after this header (at the point of
+ * instantiation) whatever the coefficient type, so that specialized versions
+ * can be provided for some coefficient types (see polynomial_ff.h).
+ */
+struct PolyKernel {};
+
+// Products of polynomials with at least this many coefficients use Karatsuba.
+#ifndef POLY_KARATSUBA_CUTOFF
+#define POLY_KARATSUBA_CUTOFF 64
+#endif
+
+// Divisions with a quotient and a divisor both at least this long use Newton
+// iteration.
+#ifndef POLY_NEWTON_DIVISION_CUTOFF
+#define POLY_NEWTON_DIVISION_CUTOFF 512
+#endif
+
+// Gcds of polynomials of at least this degree use the half-GCD algorithm,
+// which runs Euclid's algorithm (with its cofactors) below
+// POLY_HALF_GCD_BASE_CASE. Extended gcds use it from that degree.
+#ifndef POLY_HALF_GCD_CUTOFF
+#define POLY_HALF_GCD_CUTOFF 1024
+#endif
+#ifndef POLY_HALF_GCD_BASE_CASE
+#define POLY_HALF_GCD_BASE_CASE 128
+#endif
+
+// Reductions modulo a PolyModulus of at least this degree use the inverse of
+// its reversal.
+#ifndef POLY_MODULUS_NEWTON_CUTOFF
+#define POLY_MODULUS_NEWTON_CUTOFF 512
+#endif
+
+// Products of double or int64_t polynomials with at least this many
+// coefficients use FFTs.
+#ifndef POLY_FFT_CUTOFF
+#define POLY_FFT_CUTOFF 256
+#endif
+
+// Parallel products split their operands down to this many coefficients, the
+// pieces being multiplied by coeffsMul.
+#ifndef POLY_PARALLEL_MUL_GRAIN
+#define POLY_PARALLEL_MUL_GRAIN 4096
+#endif
+
+/* dst[i] += src[i] for i < len */
+template <typename T>
+void coeffsAdd(PolyKernel, T *dst, const T *src, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] += src[i];
+  }
+}
+
+/* dst[i] -= src[i] for i < len */
+template <typename T>
+void coeffsSub(PolyKernel, T *dst, const T *src, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] -= src[i];
+  }
+}
+
+/* dst[i] *= m for i < len */
+template <typename T>
+void coeffsScale(PolyKernel, T *dst, const T &m, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] *= m;
+  }
+}
+
+/* dst[i] += m * src[i] for i < len */
+template <typename T>
+void coeffsAddMul(PolyKernel, T *dst, const T *src, const T &m, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] += m * src[i];
+  }
+}
+
+/* v[i] = 1 / v[i] for i < len, zeros being left untouched */
+template <typename T>
+void coeffsInverse(PolyKernel, T *v, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    if(v[i] != T(0)) {
+      v[i] = T(1) / v[i];
+    }
+  }
+}
+
+/* dst[i] = random coefficient for i < len, as the values of rand() */
+template <typename T>
+void coeffsRandom(PolyKernel, T *dst, size_t len, RandomGenerator &rng) {
+  for(size_t i = 0; i < len; i++) {
+    dst[i] = static_cast<T>(static_cast<int>(rng.next() >> 33));
+  }
+}
+
+/*
+ * Runner of the pool tasks working on coefficients of type T, in the state of
+ * the calling thread these coefficients depend on: none by default, the field
+ * context for DynFFElem and ExtFFElem (see their headers).
+ */
+template <typename T>
+std::function<void(const std::function<void()> &)> coeffsContext(PolyKernel, const T *) {
+  return [](const std::function<void()> &task) { task(); };
+}
+
+/* r[i] += a[i-j] * b[j] for i < na+nb-1 */
+template <typename T>
+void coeffsMulSchoolbook(PolyKernel, T *r, const T *a, size_t na, const T *b, size_t nb) {
+  for(size_t i = 0; i < na; i++) {
+    coeffsAddMul(PolyKernel(), r + i, b, a[i], nb);
+  }
+}
+
+/* Number of scratch elements needed by coeffsMulKaratsuba for operands of length n */
+inline size_t karatsubaScratchSize(size_t n) {
+  if(n < POLY_KARATSUBA_CUTOFF || n < 2) {
+    return 0;
+  }
+  size_t h = n/2, m = n-h;
+  return 2*m + (2*h-1) + 2*(2*m-1) + karatsubaScratchSize(m);
+}
+
+/*
+ * Karatsuba: r[i] += a[i-j] * b[j] for a and b both of length n, using
+ * (a0 + X^h a1)(b0 + X^h b1) = z0 + X^h z1 + X^2h z2 with z0 = a0 b0, z2 = a1 b1
+ * and z1 = (a0 + a1)(b0 + b1) - z0 - z2.
+ * All temporaries live in scratch, which must hold karatsubaScratchSize(n)
+ * elements.
+ */
+template <typename T>
+void coeffsMulKaratsuba(PolyKernel, T *r, const T *a, const T *b, size_t n, T *scratch) {
+  if(n < POLY_KARATSUBA_CUTOFF || n < 2) {
+    coeffsMulSchoolbook(PolyKernel(), r, a, n, b, n);
+    return;
+  }
+  size_t h = n/2, m = n-h;
+  T *sa = scratch;
+  T *sb = sa + m;
+  T *z0 = sb + m;
+  T *z2 = z0 + 2*h-1;
+  T *z1 = z2 + 2*m-1;
+  T *next = z1 + 2*m-1;
+  std::copy(a+h, a+n, sa);
+  coeffsAdd(PolyKernel(), sa, a, h);
+  std::copy(b+h, b+n, sb);
+  coeffsAdd(PolyKernel(), sb, b, h);
+  std::fill(z0, next, T(0));
+  coeffsMulKaratsuba(PolyKernel(), z0, a, b, h, next);
+  coeffsMulKaratsuba(PolyKernel(), z2, a+h, b+h, m, next);
+  coeffsMulKaratsuba(PolyKernel(), z1, sa, sb, m, next);
+  coeffsSub(PolyKernel(), z1, z0, 2*h-1);
+  coeffsSub(PolyKernel(), z1, z2, 2*m-1);
+  coeffsAdd(PolyKernel(), r, z0, 2*h-1);
+  coeffsAdd(PolyKernel(), r+h, z1, 2*m-1);
+  coeffsAdd(PolyKernel(), r+2*h, z2, 2*m-1);
+}
+
+/*
+ * Adds the product of the polynomials a and b to r, using Karatsuba when both
+ * are at least POLY_KARATSUBA_CUTOFF long. The longest operand is cut in
+ * slices as long as the other one.
+ */
+template <typename T>
+void coeffsMul(PolyKernel, T *r, const T *a, size_t na, const T *b, size_t nb) {
+  if(na < nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  if(nb < POLY_KARATSUBA_CUTOFF) {
+    coeffsMulSchoolbook(PolyKernel(), r, a, na, b, nb);
+    return;
+  }
+  std::vector<T> scratch(karatsubaScratchSize(nb));
+  size_t i = 0;
+  for(; i + nb <= na; i += nb) {
+    coeffsMulKaratsuba(PolyKernel(), r+i, a+i, b, nb, scratch.data());
+  }
+  if(i < na) {
+    coeffsMul(PolyKernel(), r+i, b, nb, a+i, na-i);
+  }
+}
+
+/*
+ * FFT product for doubles. The error being bounded relatively to the norms of
+ * the operands, small coefficients of the result can be less accurate than
+ * with the schoolbook product.
+ */
+inline void coeffsMul(PolyKernel, double *r, const double *a, size_t na, const double *b, size_t nb) {
+  if(std::min(na, nb) >= POLY_FFT_CUTOFF) {
+    std::vector<double> product(na+nb-1);
+    fftMulReal(product.data(), a, na, b, nb);
+    if(std::all_of(product.begin(), product.end(), [](double x) { return std::isfinite(x); })) {
+      coeffsAdd(PolyKernel(), r, product.data(), product.size());
+      return;
+    }
+  }
+  coeffsMul<double>(PolyKernel(), r, a, na, b, nb);
+}
+
+/* FFT product for int64_t, when it can be certified exact */
+inline void coeffsMul(PolyKernel, int64_t *r, const int64_t *a, size_t na, const int64_t *b, size_t nb) {
+  if(std::min(na, nb) >= POLY_FFT_CUTOFF && fftMulInt64(r, a, na, b, nb)) {
+    return;
+  }
+  coeffsMul<int64_t>(PolyKernel(), r, a, na, b, nb);
+}
+
+/*
+ * Adds the product of a and b to r as coeffsMul does, running the products of
+ * a Karatsuba step as tasks of the pool (the two halves of the longest
+ * operand if it is at least twice as long as the other) down to
+ * POLY_PARALLEL_MUL_GRAIN coefficients. The pieces use coeffsMul and thus the
+ * best product for the coefficients.
+ */
+template <typename T>
+void coeffsMulParallel(PolyKernel, T *r, const T *a, size_t na, const T *b, size_t nb, ThreadPool &pool) {
+  if(na < nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  if(nb < size_t(std::max(POLY_PARALLEL_MUL_GRAIN, 2))) {
+    coeffsMul(PolyKernel(), r, a, na, b, nb);
+    return;
+  }
+  auto inContext = coeffsContext(PolyKernel(), a);
+  TaskGroup group(pool);
+  if(na >= 2*nb) {
+    // The products of both halves overlap in r: the second one is added later
+    size_t h = na/2;
+    std::vector<T> high(na-h+nb-1, T(0));
+    group.run([&]() { inContext([&]() { coeffsMulParallel(PolyKernel(), high.data(), a+h, na-h, b, nb, pool); }); });
+    coeffsMulParallel(PolyKernel(), r, a, h, b, nb, pool);
+    group.wait();
+    coeffsAdd(PolyKernel(), r+h, high.data(), high.size());
+    return;
+  }
+  // (a0 + X^h a1)(b0 + X^h b1) with h < nb, as in coeffsMulKaratsuba
+  size_t h = na/2, ma = na-h, mb = nb-h;
+  std::vector<T> sa(a+h, a+na);
+  coeffsAdd(PolyKernel(), sa.data(), a, h);
+  std::vector<T> sb(std::max(h, mb), T(0));
+  std::copy(b, b+h, sb.begin());
+  coeffsAdd(PolyKernel(), sb.data(), b+h, mb);
+  std::vector<T> z0(2*h-1, T(0)), z2(ma+mb-1, T(0)), z1(sa.size()+sb.size()-1, T(0));
+  group.run([&]() { inContext([&]() { coeffsMulParallel(PolyKernel(), z0.data(), a, h, b, h, pool); }); });
+  group.run([&]() { inContext([&]() { coeffsMulParallel(PolyKernel(), z2.data(), a+h, ma, b+h, mb, pool); }); });
+  coeffsMulParallel(PolyKernel(), z1.data(), sa.data(), sa.size(), sb.data(), sb.size(), pool);
+  group.wait();
+  coeffsSub(PolyKernel(), z1.data(), z0.data(), z0.size());
+  coeffsSub(PolyKernel(), z1.data(), z2.data(), z2.size());
+  coeffsAdd(PolyKernel(), r, z0.data(), z0.size());
+  coeffsAdd(PolyKernel(), r+h, z1.data(), z1.size());
+  coeffsAdd(PolyKernel(), r+2*h, z2.data(), z2.size());
+}
 
 template <typename T>
 class Poly {
@@ -29,8 +295,11 @@ class Poly {
     Poly<T> squareFreePart(int p) const;
     std::vector<std::pair<Poly<T>, int>> squareFreeFactors(int p) const;
     std::vector<Poly<T>> distinctDegreeFactors(int p) const;
+    std::vector<Poly<T>> distinctDegreeFactors(int p, ThreadPool &pool) const;
     Poly<T> cantorZassenhaus(int p) const;
     Poly<T> equalDegreeFactorize(int p, int i) const;
+    Poly<T> equalDegreeFactorize(int p, int i, ThreadPool &pool, size_t trials = 0) const;
+    std::vector<std::pair<Poly<T>, int>> factor(int p) const;
 
     Poly<T>& operator-=(const Poly<T> &p);
     Poly<T>& operator+=(const Poly<T> &p);
@@ -38,6 +307,7 @@ class Poly {
 
     static Poly<T> Xn(int n);
     static Poly<T> Rand(int n);
+    static Poly<T> Rand(int n, RandomGenerator &rng);
 
   //protected:
 		std::vector<T> coeffs_;
@@ -123,9 +393,7 @@ Poly<T> operator+(const Poly<T> &a, const Poly<T> &b) {
 template <typename T>
 Poly<T> operator*(T m, const Poly<T> &p) {
   Poly<T> r(p);
-  for(auto it = r.coeffs_.begin(); it != r.coeffs_.end(); it++) {
-    *it *= m;
-  }
+  coeffsScale(PolyKernel(), r.coeffs_.data(), m, r.coeffs_.size());
   r.simplify();
   return r;
 }
@@ -140,23 +408,92 @@ Poly<T> operator/(const Poly<T> &p, T d) {
   return r;
 }
 
+/*
+ * First len coefficients of the inverse of the power series f (f[0] being
+ * invertible), by Newton iteration: g <- g - g (f g - 1), which doubles the
+ * number of correct coefficients at each step.
+ */
+template <typename T>
+std::vector<T> seriesInverse(const std::vector<T> &f, size_t len) {
+  std::vector<T> g(1, T(1) / f[0]);
+  while(g.size() < len) {
+    size_t l = g.size();
+    size_t l2 = std::min(2*l, len);
+    size_t nf = std::min(f.size(), l2);
+    // f g = 1 + X^l h mod X^l2
+    std::vector<T> fg(nf+l-1);
+    coeffsMul(PolyKernel(), fg.data(), f.data(), nf, g.data(), l);
+    std::vector<T> h(l2-l);
+    for(size_t i = l; i < std::min(l2, fg.size()); i++) {
+      h[i-l] = fg[i];
+    }
+    std::vector<T> gh(l+h.size()-1);
+    coeffsMul(PolyKernel(), gh.data(), g.data(), l, h.data(), h.size());
+    g.resize(l2);
+    for(size_t i = l; i < l2; i++) {
+      g[i] = -gh[i-l];
+    }
+  }
+  g.resize(len);
+  return g;
+}
+
+/*
+ * Division with remainder in O(M(n)): with rev(p) = X^deg(p) p(1/X), the
+ * quotient is given by rev(q) = rev(a) / rev(b) mod X^(deg(a)-deg(b)+1), rev(b)
+ * being invertible as a power series when the leading coefficient of b is.
+ * a and b must be simplified, with deg(a) >= deg(b).
+ */
+template <typename T>
+std::pair<Poly<T>, Poly<T>> newtonDivide(const Poly<T> &a, const Poly<T> &b) {
+  size_t m = b.degree();
+  size_t k = a.degree() - b.degree() + 1;
+  std::vector<T> ra(a.coeffs_.rbegin(), a.coeffs_.rbegin() + k);
+  std::vector<T> rb(b.coeffs_.rbegin(), b.coeffs_.rend());
+  std::vector<T> inverse = seriesInverse(rb, k);
+  std::vector<T> rq(2*k-1);
+  coeffsMul(PolyKernel(), rq.data(), ra.data(), k, inverse.data(), k);
+  Poly<T> q(std::vector<T>(rq.rend() - k, rq.rend()));
+  // Only the m low coefficients of a - b q are non zero
+  std::vector<T> bq(m+k);
+  coeffsMul(PolyKernel(), bq.data(), b.coeffs_.data(), m+1, q.coeffs_.data(), k);
+  Poly<T> r(std::vector<T>(a.coeffs_.begin(), a.coeffs_.begin() + m));
+  coeffsSub(PolyKernel(), r.coeffs_.data(), bq.data(), m);
+  q.simplify();
+  r.simplify();
+  return std::make_pair(q, r);
+}
+
 template <typename T>
 std::pair<Poly<T>, Poly<T>> euclidDivide(const Poly<T> &a, const Poly<T> &b) {
   //std::cout << "euclidDivide(\n   - " << a << "\n   - " << b << "\n) = ";
   Poly<T> r(a);
+  Poly<T> d(b);
+  r.simplify();
+  d.simplify();
+  if(d.null()) {
+    std::cerr << "Oups, division by a null polynom !!!" << std::endl;
+    return std::make_pair(Poly<T>(), r);
+  }
+  auto lead = d.coeffs_[d.degree()];
+  if(r.degree() >= d.degree() && std::min(r.degree() - d.degree() + 1, d.degree()) >= POLY_NEWTON_DIVISION_CUTOFF) {
+    // Newton iteration needs the leading coefficient to be invertible
+    if((T(1) / lead) * lead == T(1)) {
+      return newtonDivide(r, d);
+    }
+  }
   Poly<T> q; 
-  auto d = b.degree();
-  int qsize = std::max(a.degree() - b.degree(), 0)+1;
+  int qsize = std::max(r.degree() - d.degree(), 0)+1;
   q.coeffs_.resize(qsize);
-  while(r.degree() >= d) {
-    int n = r.degree() - b.degree();
-    //std::cout << "N=" << n << ", deg(r)=" << r.degree() << ", deg(b)=" << b.degree() << std::endl;
-    // TODO / BUG: divide by 0 when b is not simplified
-    q.coeffs_[n] = r.coeffs_[r.degree()] / b.coeffs_[b.degree()];
-    r -= q.coeffs_[n] * b * Poly<T>::Xn(n);
+  while(r.degree() >= d.degree()) {
+    int n = r.degree() - d.degree();
+    //std::cout << "N=" << n << ", deg(r)=" << r.degree() << ", deg(b)=" << d.degree() << std::endl;
+    q.coeffs_[n] = r.coeffs_[r.degree()] / lead;
+    // r -= q_n X^n b
+    coeffsAddMul(PolyKernel(), r.coeffs_.data() + n, d.coeffs_.data(), -q.coeffs_[n], d.coeffs_.size());
+    r.simplify();
     //std::cout << " -> " << q.coeffs_[n] << "x^" << n << "\n    q = " << q << "\n    r = " << r << std::endl;
   }
-  r.simplify();
   q.simplify();
   //std::cout << "(" << q << ", " << r << ")" << std::endl;
   return std::make_pair(q, r);
@@ -172,6 +509,136 @@ Poly<T> operator/(const Poly<T> &a, const Poly<T> &b) {
   return euclidDivide(a,b).first;
 }
 
+/*
+ * Context for computations modulo a fixed polynomial f: the inverse of its
+ * reversal as a power series is computed once, so that reductions of
+ * products cost two products as in newtonDivide. The scratch buffers are
+ * shared by all the reductions: a context must not be used by several
+ * threads at the same time.
+ */
+template <typename T>
+class PolyModulus {
+  public:
+    PolyModulus(const Poly<T> &f);
+
+    const Poly<T> &modulus() const;
+    // a mod f
+    Poly<T> reduce(const Poly<T> &a) const;
+    // a b mod f, for a and b reduced
+    Poly<T> mulMod(const Poly<T> &a, const Poly<T> &b) const;
+
+  protected:
+    Poly<T> f_;
+    // First deg(f) coefficients of 1 / rev(f), empty when reductions use euclidDivide
+    std::vector<T> inverse_;
+    mutable std::vector<T> scratch_;
+};
+
+template <typename T>
+PolyModulus<T>::PolyModulus(const Poly<T> &f) : f_(f) {
+  f_.simplify();
+  if(f_.degree() >= POLY_MODULUS_NEWTON_CUTOFF) {
+    T lead = f_.coeffs_[f_.degree()];
+    // Newton iteration needs the leading coefficient to be invertible
+    if((T(1) / lead) * lead == T(1)) {
+      std::vector<T> rf(f_.coeffs_.rbegin(), f_.coeffs_.rend());
+      inverse_ = seriesInverse(rf, f_.degree());
+    }
+  }
+}
+
+template <typename T>
+const Poly<T> &PolyModulus<T>::modulus() const {
+  return f_;
+}
+
+template <typename T>
+Poly<T> PolyModulus<T>::reduce(const Poly<T> &a) const {
+  int n = f_.degree();
+  if(a.degree() < n) {
+    return a;
+  }
+  if(inverse_.empty() || a.degree() >= 2*n) {
+    return a % f_;
+  }
+  // Quotient as in newtonDivide: rev(q) = rev(a) / rev(f) mod X^k
+  size_t k = a.degree() - n + 1;
+  scratch_.assign(2*k-1 + n+k-1 + k, T(0));
+  T *rq = scratch_.data();
+  T *fq = rq + 2*k-1;
+  T *q = fq + n+k-1;
+  std::vector<T> ra(a.coeffs_.rbegin(), a.coeffs_.rbegin() + k);
+  coeffsMul(PolyKernel(), rq, ra.data(), k, inverse_.data(), k);
+  std::reverse_copy(rq, rq + k, q);
+  // Only the n low coefficients of a - f q are non zero
+  coeffsMul(PolyKernel(), fq, f_.coeffs_.data(), n, q, k);
+  Poly<T> r(std::vector<T>(a.coeffs_.begin(), a.coeffs_.begin() + n));
+  coeffsSub(PolyKernel(), r.coeffs_.data(), fq, n);
+  r.simplify();
+  return r;
+}
+
+template <typename T>
+Poly<T> PolyModulus<T>::mulMod(const Poly<T> &a, const Poly<T> &b) const {
+  return reduce(a * b);
+}
+
+/* a^e mod f by square and multiply, E being any integer type (e.g. uint64_t or a big integer) */
+template <typename T, typename E>
+Poly<T> powmod(const Poly<T> &a, E e, const PolyModulus<T> &ctx) {
+  Poly<T> result = ctx.reduce(Poly<T>::Xn(0));
+  Poly<T> x = ctx.reduce(a);
+  while(e > 0) {
+    if(e % 2 != 0) {
+      result = ctx.mulMod(result, x);
+    }
+    e /= 2;
+    if(e > 0) {
+      x = ctx.mulMod(x, x);
+    }
+  }
+  return result;
+}
+
+/* h^0, h^1, ..., h^k mod f */
+template <typename T>
+std::vector<Poly<T>> powersMod(const Poly<T> &h, int k, const PolyModulus<T> &ctx) {
+  std::vector<Poly<T>> powers(k+1);
+  powers[0] = ctx.reduce(Poly<T>::Xn(0));
+  if(k > 0) {
+    powers[1] = ctx.reduce(h);
+  }
+  for(int i = 2; i <= k; i++) {
+    powers[i] = ctx.mulMod(powers[i-1], powers[1]);
+  }
+  return powers;
+}
+
+/*
+ * Modular composition g(h) mod f (Brent and Kung), powers being
+ * powersMod(h, m, ctx): g is cut in blocks of m coefficients, each of them
+ * evaluated at h as a linear combination of the powers, and the blocks are
+ * put together by Horner's rule in h^m. This costs about deg(g) deg(f)
+ * operations on coefficients and deg(g)/m products modulo f.
+ */
+template <typename T>
+Poly<T> composeMod(const Poly<T> &g, const std::vector<Poly<T>> &powers, const PolyModulus<T> &ctx) {
+  size_t m = powers.size() - 1;
+  size_t n = std::max(ctx.modulus().degree(), 0);
+  size_t blocks = (g.coeffs_.size() + m - 1) / m;
+  Poly<T> result;
+  Poly<T> block;
+  for(size_t j = blocks; j-- > 0;) {
+    block.coeffs_.assign(n, T(0));
+    for(size_t i = 0; i < m && j*m + i < g.coeffs_.size(); i++) {
+      coeffsAddMul(PolyKernel(), block.coeffs_.data(), powers[i].coeffs_.data(), g.coeffs_[j*m + i], powers[i].coeffs_.size());
+    }
+    block.simplify();
+    result = ctx.mulMod(result, powers[m]) + block;
+  }
+  return result;
+}
+
 template <typename T>
 Poly<T>::Poly(std::vector<T> coeffs) {
   coeffs_ = coeffs;
@@ -192,12 +659,17 @@ Poly<T> Poly<T>::Xn(int n) {
   return p;
 }
 
+/* Polynom of degree < n with random coefficients from the generator of the thread */
 template <typename T>
 Poly<T> Poly<T>::Rand(int n) {
+  return Rand(n, RandomGenerator::current());
+}
+
+template <typename T>
+Poly<T> Poly<T>::Rand(int n, RandomGenerator &rng) {
   Poly<T> p;
-  for(int i = 0; i < n; i++) {
-    p.coeffs_.push_back(static_cast<T>(rand()));
-  }
+  p.coeffs_.resize(std::max(n, 0));
+  coeffsRandom(PolyKernel(), p.coeffs_.data(), p.coeffs_.size(), rng);
   p.simplify();
   return p;
 }
@@ -218,14 +690,10 @@ void Poly<T>::simplify() {
 
 template <typename T>
 Poly<T>& Poly<T>::operator-=(const Poly<T> &other) {
-  size_t i = 0;
-  for(auto it = other.coeffs_.begin(); it != other.coeffs_.end(); it++) {
-    if(i < this->coeffs_.size()) {
-      this->coeffs_[i] -= *it;
-    } else {
-      this->coeffs_.push_back(-(*it));
-    }
-    i++;
+  size_t common = std::min(coeffs_.size(), other.coeffs_.size());
+  coeffsSub(PolyKernel(), coeffs_.data(), other.coeffs_.data(), common);
+  for(size_t i = common; i < other.coeffs_.size(); i++) {
+    this->coeffs_.push_back(-other.coeffs_[i]);
   }
   this->simplify();
   return *this;
@@ -233,32 +701,32 @@ Poly<T>& Poly<T>::operator-=(const Poly<T> &other) {
 
 template <typename T>
 Poly<T>& Poly<T>::operator*=(const Poly<T> &other) {
-  auto deg = degree() + other.degree();
   Poly<T> result;
-  result.coeffs_.resize(deg+1);
-  int i(0);
-  for(auto itA = coeffs_.begin(); itA != coeffs_.end(); itA++) {
-    int j(0);
-    for(auto itB = other.coeffs_.begin(); itB != other.coeffs_.end(); itB++) {
-      result.coeffs_[i+j] += (*itB)*(*itA);
-      j++;
-    }
-    i++;
+  if(!coeffs_.empty() && !other.coeffs_.empty()) {
+    result.coeffs_.resize(coeffs_.size() + other.coeffs_.size() - 1);
+    coeffsMul(PolyKernel(), result.coeffs_.data(), coeffs_.data(), coeffs_.size(), other.coeffs_.data(), other.coeffs_.size());
   }
   *this = result;
   return *this;
 }
 
+/* a * b, computed with the tasks of the pool (see coeffsMulParallel) */
+template <typename T>
+Poly<T> parallelMul(const Poly<T> &a, const Poly<T> &b, ThreadPool &pool = ThreadPool::instance()) {
+  Poly<T> result;
+  if(!a.coeffs_.empty() && !b.coeffs_.empty()) {
+    result.coeffs_.resize(a.coeffs_.size() + b.coeffs_.size() - 1);
+    coeffsMulParallel(PolyKernel(), result.coeffs_.data(), a.coeffs_.data(), a.coeffs_.size(), b.coeffs_.data(), b.coeffs_.size(), pool);
+  }
+  return result;
+}
+
 template <typename T>
 Poly<T>& Poly<T>::operator+=(const Poly<T> &other) {
-  size_t i = 0;
-  for(auto it = other.coeffs_.begin(); it != other.coeffs_.end(); it++) {
-    if(i < this->coeffs_.size()) {
-      this->coeffs_[i] += *it;
-    } else {
-      this->coeffs_.push_back(*it);
-    }
-    i++;
+  size_t common = std::min(coeffs_.size(), other.coeffs_.size());
+  coeffsAdd(PolyKernel(), coeffs_.data(), other.coeffs_.data(), common);
+  for(size_t i = common; i < other.coeffs_.size(); i++) {
+    this->coeffs_.push_back(other.coeffs_[i]);
   }
   this->simplify();
   return *this;
@@ -288,26 +756,170 @@ Poly<T> Poly<T>::derivate() const {
   return p;
 }
 
+/* 2x2 matrix of polynomials, acting on pairs (a, b) of consecutive remainders */
+template <typename T>
+struct PolyMatrix {
+  Poly<T> m00, m01, m10, m11;
+};
+
+template <typename T>
+PolyMatrix<T> polyMatrixIdentity() {
+  PolyMatrix<T> m;
+  m.m00 = m.m11 = Poly<T>::Xn(0);
+  return m;
+}
+
+template <typename T>
+PolyMatrix<T> operator*(const PolyMatrix<T> &a, const PolyMatrix<T> &b) {
+  PolyMatrix<T> r;
+  r.m00 = a.m00 * b.m00 + a.m01 * b.m10;
+  r.m01 = a.m00 * b.m01 + a.m01 * b.m11;
+  r.m10 = a.m10 * b.m00 + a.m11 * b.m10;
+  r.m11 = a.m10 * b.m01 + a.m11 * b.m11;
+  return r;
+}
+
+/* (a, b) <- m (a, b) */
+template <typename T>
+void applyMatrix(const PolyMatrix<T> &m, Poly<T> &a, Poly<T> &b) {
+  Poly<T> na = m.m00 * a + m.m01 * b;
+  b = m.m10 * a + m.m11 * b;
+  a = na;
+}
+
+/* One step of Euclid's algorithm: (a, b) <- (b, a % b), m <- (0 1, 1 -q) m */
+template <typename T>
+void euclidStep(Poly<T> &a, Poly<T> &b, PolyMatrix<T> &m) {
+  auto qr = euclidDivide(a, b);
+  a = b;
+  b = qr.second;
+  Poly<T> m10 = m.m00 - qr.first * m.m10;
+  Poly<T> m11 = m.m01 - qr.first * m.m11;
+  m.m00 = m.m10;
+  m.m01 = m.m11;
+  m.m10 = m10;
+  m.m11 = m11;
+}
+
+/* p / X^k */
+template <typename T>
+Poly<T> shiftDown(const Poly<T> &p, int k) {
+  if(p.degree() < k) {
+    return Poly<T>();
+  }
+  Poly<T> r(std::vector<T>(p.coeffs_.begin() + k, p.coeffs_.end()));
+  r.simplify();
+  return r;
+}
+
+/*
+ * Half-GCD: for deg(a) > deg(b), the matrix taking (a, b) to the first pair
+ * of consecutive remainders (r_i, r_i+1) of their Euclidean remainder sequence
+ * with deg(r_i+1) < m = ceil(deg(a)/2). The quotients giving the remainders
+ * of degree above m only depend on the high coefficients of a and b, so that
+ * this matrix is obtained from two recursive calls on polynomials of half the
+ * degree, for a cost of O(M(n) log(n)).
+ */
+template <typename T>
+PolyMatrix<T> halfGcd(Poly<T> a, Poly<T> b) {
+  int m = (a.degree() + 1) / 2;
+  PolyMatrix<T> r = polyMatrixIdentity<T>();
+  if(b.degree() < m) {
+    return r;
+  }
+  if(a.degree() < POLY_HALF_GCD_BASE_CASE) {
+    while(b.degree() >= m) {
+      euclidStep(a, b, r);
+    }
+    return r;
+  }
+  r = halfGcd(shiftDown(a, m), shiftDown(b, m));
+  applyMatrix(r, a, b);
+  if(b.degree() < m) {
+    return r;
+  }
+  euclidStep(a, b, r);
+  if(b.degree() < m) {
+    return r;
+  }
+  int k = 2*m - a.degree();
+  return halfGcd(shiftDown(a, k), shiftDown(b, k)) * r;
+}
+
+/*
+ * Runs Euclid's algorithm on (a, b) up to a null remainder, a being left with
+ * the last non null one. Large remainders are skipped using halfGcd. The
+ * matrix of the whole remainder sequence is accumulated in m if not null.
+ */
+template <typename T>
+void remainderSequence(Poly<T> &a, Poly<T> &b, PolyMatrix<T> *m) {
+  // Classical steps are more expensive when they update the matrix
+  int cutoff = m ? POLY_HALF_GCD_BASE_CASE : POLY_HALF_GCD_CUTOFF;
+  while(!b.null()) {
+    if(a.degree() > b.degree() && b.degree() >= cutoff) {
+      PolyMatrix<T> h = halfGcd(a, b);
+      applyMatrix(h, a, b);
+      if(m) {
+        *m = h * (*m);
+      }
+      if(b.null()) {
+        break;
+      }
+    }
+    if(m) {
+      euclidStep(a, b, *m);
+    } else {
+      Poly<T> r = a % b;
+      a = b;
+      b = r;
+    }
+  }
+}
+
 template <typename T>
 Poly<T> gcd(Poly<T> a, Poly<T> b) {
+  a.simplify();
+  b.simplify();
   if(a.degree() < b.degree()) {
-    Poly<T> tmp = a;
-    a = b;
-    b = tmp;
-  }
-  //std::cout << "gcd(\n   - " << a << "\n   - " << b << "\n): " << std::endl;
-  Poly<T> r = a % b;
-  while(!r.null()) {
-    //std::cout << "gcd(\n   - " << b << "\n   - " << r << "\n): " << std::endl;
-    a = b;
-    b = r;
-    r = a % b; 
-  }
-  //std::cout << "gcd = " << b;
+    std::swap(a, b);
+  }
+  remainderSequence(a, b, static_cast<PolyMatrix<T>*>(nullptr));
+  if(a.null()) {
+    return a;
+  }
   // Normalize the polynom:
-  b = b / b.coeffs_[b.degree()];
-  //std::cout << " = " << b << std::endl;
-  return b;
+  return a / a.coeffs_[a.degree()];
+}
+
+/* Returns g = gcd(a, b) (monic) and sets u and v such that u a + v b = g */
+template <typename T>
+Poly<T> extendedGcd(Poly<T> a, Poly<T> b, Poly<T> &u, Poly<T> &v) {
+  a.simplify();
+  b.simplify();
+  PolyMatrix<T> m = polyMatrixIdentity<T>();
+  remainderSequence(a, b, &m);
+  if(a.null()) {
+    u = v = Poly<T>();
+    return a;
+  }
+  T lead = a.coeffs_[a.degree()];
+  u = m.m00 / lead;
+  v = m.m01 / lead;
+  return a / lead;
+}
+
+/* Divides each (non null) polynom by its leading coefficient, inverting them all at once */
+template <typename T>
+void makeMonic(std::vector<Poly<T>> &polys) {
+  std::vector<T> leads;
+  for(auto it = polys.begin(); it != polys.end(); it++) {
+    it->simplify();
+    leads.push_back(it->null() ? T(0) : it->coeffs_[it->degree()]);
+  }
+  coeffsInverse(PolyKernel(), leads.data(), leads.size());
+  for(size_t i = 0; i < polys.size(); i++) {
+    coeffsScale(PolyKernel(), polys[i].coeffs_.data(), leads[i], polys[i].coeffs_.size());
+  }
 }
 
 template <typename T>
@@ -376,9 +988,12 @@ std::vector<std::pair<Poly<T>, int>> Poly<T>::squareFreeFactors(int p) const {
     }
     if (c != unit) {
       //std::cout << "Unpowering " << c << " with degree " << p << std::endl;
-      c = c.unpower(p);
-      //std::cout << "Adding(2) " << c << " with degree " << p << std::endl;
-      result.push_back(std::make_pair(c, p));
+      // c is a p-th power, whose root can have several square free factors
+      auto root = c.unpower(p).squareFreeFactors(p);
+      for(auto it = root.begin(); it != root.end(); it++) {
+        //std::cout << "Adding(2) " << it->first << " with degree " << it->second*p << std::endl;
+        result.push_back(std::make_pair(it->first, it->second*p));
+      }
       return result;
     }
     else {
@@ -395,46 +1010,330 @@ std::vector<std::pair<Poly<T>, int>> Poly<T>::squareFreeFactors(int p) const {
   }
 }
 
-/* Return distinct degree factors for a polynom on a finite field of characteristic p */
+/*
+ * Return distinct degree factors for a polynom on a finite field of
+ * characteristic p: the i-th one is the product of the irreducible factors of
+ * degree i+1 (those after the largest degree being null).
+ *
+ * This is the baby step giant step algorithm of Kaltofen and Shoup. With
+ * h_i = X^(p^i) mod f, X^(p^(i+j)) = h_i(h_j) is obtained by modular
+ * composition, without powering. Baby steps h_0, ..., h_l-1 and giant steps
+ * H_j = h_lj give the products of the factors with a degree in
+ * (l(j-1), lj] as gcd(f, prod_i (H_j - h_i)), which are then split in the
+ * same way as gcds with H_j - h_i. Factors of degree above deg(f)/2 are left
+ * alone and need no giant step.
+ */
 template <typename T>
 std::vector<Poly<T>> Poly<T>::distinctDegreeFactors(int p) const {
+  return distinctDegreeSplit(this->squareFreePart(p), p);
+}
+
+/* distinctDegreeFactors with the intervals of degrees handled in parallel */
+template <typename T>
+std::vector<Poly<T>> Poly<T>::distinctDegreeFactors(int p, ThreadPool &pool) const {
+  return distinctDegreeSplit(this->squareFreePart(p), p, static_cast<std::vector<Poly<T>>*>(nullptr), &pool);
+}
+
+/*
+ * Distinct degree factorization of the square free polynom f, as returned by
+ * distinctDegreeFactors. When the powers of the Frobenius X^p mod f are used
+ * for compositions, they are stored in frobeniusPowers (if not null) for the
+ * equal degree factorization.
+ *
+ * With a pool, all the giant steps are computed first, and the interval
+ * products and gcds then run as tasks of the pool.
+ */
+template <typename T>
+std::vector<Poly<T>> distinctDegreeSplit(const Poly<T> &f, int p, std::vector<Poly<T>> *frobeniusPowers = nullptr, ThreadPool *pool = nullptr) {
   std::vector<Poly<T>> g;
-  auto f = this->squareFreePart(p);
-  //auto f = *this;
-  g.resize(f.degree());
-  //std::cout << "distinctDegreeFactors(" << *this << ") => " << f << ": " << std::endl;
-  for(int i = 0; i < f.degree(); i++) {
-    g[i] = gcd(f, Poly<T>::Xn(pow(p, i+1)) - Poly<T>::Xn(1));
-    g[i].simplify();
-    f = f / g[i];
-    //std::cout << "  factor " << i << ": " << g[i] << std::endl;
+  auto unit = Poly<T>::Xn(0);
+  int n = f.degree();
+  g.resize(std::max(n, 0));
+  if(n <= 0) {
+    return g;
+  }
+  PolyModulus<T> ctx(f);
+  int l = 1;
+  while(2*l*l < n) {
+    l++;
+  }
+  int m = 1;
+  while(m*m <= n) {
+    m++;
+  }
+  // A composition costs about m products, raising to the power p about
+  // log2(p): small characteristics use powers instead
+  int bits = 0;
+  while((uint64_t(1) << bits) <= uint64_t(p)) {
+    bits++;
+  }
+  // Baby steps
+  std::vector<Poly<T>> baby(l+1);
+  baby[0] = ctx.reduce(Poly<T>::Xn(1));
+  baby[1] = powmod(baby[0], uint64_t(p), ctx);
+  std::vector<Poly<T>> frobenius;
+  if(bits >= m) {
+    frobenius = powersMod(baby[1], m, ctx);
+    if(frobeniusPowers) {
+      *frobeniusPowers = frobenius;
+    }
+  }
+  for(int i = 2; i <= l; i++) {
+    baby[i] = bits < m ? powmod(baby[i-1], uint64_t(p), ctx) : composeMod(baby[i-1], frobenius, ctx);
+  }
+  // Giant steps, up to the point where the factors left are irreducible
+  std::vector<Poly<T>> giant;
+  if(l*bits >= m) {
+    giant = powersMod(baby[l], m, ctx);
+  }
+  auto rest = f;
+  auto H = baby[l];
+  if(pool) {
+    // All the giant steps up to deg(f)/2 first: the products and gcds of the
+    // intervals are then independent
+    int intervals = 0;
+    while(n >= 2*(l*intervals+1)) {
+      intervals++;
+    }
+    std::vector<Poly<T>> giantSteps(intervals);
+    for(int j = 0; j < intervals; j++) {
+      if(j > 0 && l*bits < m) {
+        for(int i = 0; i < l; i++) {
+          H = powmod(H, uint64_t(p), ctx);
+        }
+      } else if(j > 0) {
+        H = composeMod(H, giant, ctx);
+      }
+      giantSteps[j] = H;
+    }
+    std::vector<Poly<T>> found(intervals);
+    auto inContext = coeffsContext(PolyKernel(), static_cast<const T *>(nullptr));
+    parallelFor(*pool, 0, intervals, 1, [&](size_t j) { inContext([&]() {
+      PolyModulus<T> local(ctx);
+      auto interval = unit;
+      for(int i = 0; i < l; i++) {
+        interval = local.mulMod(interval, giantSteps[j] - baby[i]);
+      }
+      found[j] = gcd(f, interval);
+    }); });
+    // Factors of degree in an earlier interval also divide found[j]
+    for(int j = 0; j < intervals; j++) {
+      found[j] = gcd(rest, found[j]);
+      if(found[j] != unit) {
+        rest = rest / found[j];
+      }
+    }
+    parallelFor(*pool, 0, intervals, 1, [&](size_t j) { inContext([&]() {
+      auto c = found[j];
+      for(int i = l-1; i >= 0 && c.degree() > 0; i--) {
+        auto d = gcd(c, (giantSteps[j] - baby[i]) % c);
+        if(d != unit) {
+          g[l*(j+1)-i-1] = d;
+          c = c / d;
+        }
+      }
+    }); });
+  }
+  for(int j = 1; !pool && rest.degree() >= 2*(l*(j-1)+1); j++) {
+    if(j > 1 && l*bits < m) {
+      for(int i = 0; i < l; i++) {
+        H = powmod(H, uint64_t(p), ctx);
+      }
+    } else if(j > 1) {
+      H = composeMod(H, giant, ctx);
+    }
+    auto interval = unit;
+    for(int i = 0; i < l; i++) {
+      interval = ctx.mulMod(interval, H - baby[i]);
+    }
+    auto c = gcd(rest, interval);
+    if(c == unit) {
+      continue;
+    }
+    rest = rest / c;
+    for(int i = l-1; i >= 0 && c.degree() > 0; i--) {
+      auto d = gcd(c, (H - baby[i]) % c);
+      if(d != unit) {
+        g[l*j-i-1] = d;
+        c = c / d;
+      }
+    }
+  }
+  if(rest.degree() > 0) {
+    g[rest.degree()-1] = rest / rest.coeffs_[rest.degree()];
+  }
+  // No factor: unit up to the largest degree found
+  int largest = n;
+  while(largest > 0 && g[largest-1].null()) {
+    largest--;
+  }
+  for(int i = 0; i < largest; i++) {
+    if(g[i].null()) {
+      g[i] = unit;
+    }
   }
-  //std::cout << "squareFreePart(" << *this << ") = " << (*this) << " / " << g << " = " << r << " (dp = " << dp << ")" << std::endl;
   return g;
 }
 
+/*
+ * Returns a non trivial factor of a polynom on a finite field of
+ * characteristic p whose irreducible factors all have degree d (or itself if
+ * it has only one), using random polynoms a: gcd(f, a^((p^d-1)/2) - 1) for p
+ * odd, computed as (a^(1+p+...+p^(d-1)))^((p-1)/2), and gcd(f, a + a^2 + ...
+ * + a^(2^(d-1))) for p = 2.
+ */
 template <typename T>
 Poly<T> Poly<T>::equalDegreeFactorize(int p, int d) const {
-  while(true) {
-    auto a = Poly<T>::Rand(degree()-1);
-    //std::cout << "EDF(1): " << a << std::endl;
-    auto g = gcd(*this, a);
-    //std::cout << "EDF(2): " << g << std::endl;
-    auto unit = Poly<T>::Xn(0);
-    if(g != unit) {
-      return g;
+  if(degree() <= d) {
+    return *this;
+  }
+  return equalDegreeSplit(*this, p, d, std::vector<Poly<T>>());
+}
+
+/* equalDegreeFactorize running trials on the pool at the same time */
+template <typename T>
+Poly<T> Poly<T>::equalDegreeFactorize(int p, int d, ThreadPool &pool, size_t trials) const {
+  if(degree() <= d) {
+    return *this;
+  }
+  return parallelEqualDegreeSplit(*this, p, d, std::vector<Poly<T>>(), pool, trials);
+}
+
+/*
+ * One trial of equalDegreeSplit with a polynom drawn from rng: a non trivial
+ * factor of f, or a null polynom if it doesn't split f or if firstSuccess gets
+ * below trial (the index of this trial) meanwhile. The p-th powers are
+ * compositions with frobeniusPowers (X^(ip) mod f) if there are some, powers
+ * otherwise.
+ */
+template <typename T>
+Poly<T> equalDegreeTrial(const Poly<T> &f, int p, int d, const std::vector<Poly<T>> &frobeniusPowers, const PolyModulus<T> &ctx, RandomGenerator &rng, const std::atomic<size_t> *firstSuccess = nullptr, size_t trial = 0) {
+  auto unit = Poly<T>::Xn(0);
+  auto cancelled = [firstSuccess, trial]() { return firstSuccess && firstSuccess->load(std::memory_order_relaxed) < trial; };
+  auto a = Poly<T>::Rand(f.degree(), rng);
+  if(a.null()) {
+    return Poly<T>();
+  }
+  //std::cout << "EDF(1): " << a << std::endl;
+  auto g = gcd(f, a);
+  //std::cout << "EDF(2): " << g << std::endl;
+  if(g != unit) {
+    return g;
+  }
+  Poly<T> b;
+  if(p == 2) {
+    auto t = a;
+    b = a;
+    for(int i = 1; i < d; i++) {
+      if(cancelled()) {
+        return Poly<T>();
+      }
+      t = ctx.mulMod(t, t);
+      b += t;
     }
-    int m = (std::pow(p, d)-1) / 2;
-    auto a2 = a.power(m) + unit;
-    //std::cout << "EDF(3): " << a2 << std::endl;
-    g = gcd(*this, a2);
-    //std::cout << "EDF(4): " << g << std::endl;
-    if(!a2.null() && g != unit) {
+  } else {
+    auto t = a;
+    auto norm = a;
+    for(int i = 1; i < d; i++) {
+      if(cancelled()) {
+        return Poly<T>();
+      }
+      t = frobeniusPowers.empty() ? powmod(t, uint64_t(p), ctx) : composeMod(t, frobeniusPowers, ctx);
+      norm = ctx.mulMod(norm, t);
+    }
+    if(cancelled()) {
+      return Poly<T>();
+    }
+    b = powmod(norm, uint64_t(p-1) / 2, ctx) - unit;
+  }
+  //std::cout << "EDF(3): " << b << std::endl;
+  if(b.null() || cancelled()) {
+    return Poly<T>();
+  }
+  g = gcd(f, b);
+  //std::cout << "EDF(4): " << g << std::endl;
+  if(g != unit) {
+    return g;
+  }
+  return Poly<T>();
+}
+
+/* Non trivial factor of f as returned by equalDegreeFactorize, deg(f) > d */
+template <typename T>
+Poly<T> equalDegreeSplit(const Poly<T> &f, int p, int d, const std::vector<Poly<T>> &frobeniusPowers) {
+  PolyModulus<T> ctx(f);
+  while(true) {
+    auto g = equalDegreeTrial(f, p, d, frobeniusPowers, ctx, RandomGenerator::current());
+    if(!g.null()) {
       return g;
     }
   }
 }
 
+/*
+ * equalDegreeSplit with trials tasks of the pool (as many as its workers if
+ * 0) making trials at the same time. The k-th trial draws its polynom from
+ * the k-th stream split from a generator seeded by the one of the thread, and
+ * the factor of the first successful trial is returned: the result doesn't
+ * depend on the scheduling. The trials after a successful one stop at their
+ * next check of firstSuccess.
+ */
+template <typename T>
+Poly<T> parallelEqualDegreeSplit(const Poly<T> &f, int p, int d, const std::vector<Poly<T>> &frobeniusPowers, ThreadPool &pool, size_t trials) {
+  if(trials == 0) {
+    trials = std::max(pool.size(), size_t(1));
+  }
+  RandomGenerator streams(RandomGenerator::current().next());
+  std::atomic<size_t> firstSuccess(std::numeric_limits<size_t>::max());
+  std::mutex mutex;
+  Poly<T> result;
+  auto inContext = coeffsContext(PolyKernel(), static_cast<const T *>(nullptr));
+  TaskGroup group(pool);
+  for(size_t i = 0; i < trials; i++) {
+    group.run([&, i]() { inContext([&]() {
+      // PolyModulus is not thread-safe: one per task
+      PolyModulus<T> ctx(f);
+      for(size_t k = i; k < firstSuccess.load(std::memory_order_relaxed); k += trials) {
+        auto rng = streams.split(k);
+        auto g = equalDegreeTrial(f, p, d, frobeniusPowers, ctx, rng, &firstSuccess, k);
+        if(!g.null()) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if(k < firstSuccess.load()) {
+            result = g;
+            firstSuccess.store(k);
+          }
+        }
+      }
+    }); });
+  }
+  group.wait();
+  return result;
+}
+
+/*
+ * Appends to factors the irreducible factors of the monic f, all of degree d,
+ * splitting it recursively. The powers of the Frobenius are reduced modulo
+ * each part rather than computed again.
+ */
+template <typename T>
+void equalDegreeFactors(const Poly<T> &f, int p, int d, const std::vector<Poly<T>> &frobeniusPowers, std::vector<Poly<T>> &factors) {
+  if(f.degree() <= d) {
+    factors.push_back(f);
+    return;
+  }
+  auto g = equalDegreeSplit(f, p, d, frobeniusPowers);
+  auto h = f / g;
+  std::vector<Poly<T>> powers(frobeniusPowers.size());
+  for(size_t i = 0; i < powers.size(); i++) {
+    powers[i] = frobeniusPowers[i] % g;
+  }
+  equalDegreeFactors(g, p, d, powers, factors);
+  for(size_t i = 0; i < powers.size(); i++) {
+    powers[i] = frobeniusPowers[i] % h;
+  }
+  equalDegreeFactors(h, p, d, powers, factors);
+}
+
 template <typename T>
 Poly<T> Poly<T>::cantorZassenhaus(int p) const {
   auto sfp = squareFreePart(p);
@@ -454,3 +1353,66 @@ Poly<T> Poly<T>::cantorZassenhaus(int p) const {
   std::cerr << "Oups, Cantor-Zassenhaus terminated without finding anything: shouldn't reach this line !!!" << std::endl;
   return *this;
 }
+
+/*
+ * Complete factorization of a polynom on a finite field of characteristic p:
+ * its monic irreducible factors with their multiplicities (the leading
+ * coefficient is left out). Each square free factor goes once through the
+ * distinct degree factorization, whose powers of the Frobenius are then
+ * reused by the equal degree factorization of all the parts.
+ */
+template <typename T>
+std::vector<std::pair<Poly<T>, int>> Poly<T>::factor(int p) const {
+  std::vector<std::pair<Poly<T>, int>> result;
+  auto f = *this;
+  f.simplify();
+  if(f.degree() <= 0) {
+    return result;
+  }
+  f = f / f.coeffs_[f.degree()];
+  auto sff = f.squareFreeFactors(p);
+  for(auto it = sff.begin(); it != sff.end(); it++) {
+    std::vector<Poly<T>> frobenius;
+    auto ddf = distinctDegreeSplit(it->first / it->first.coeffs_[it->first.degree()], p, &frobenius);
+    for(size_t i = 0; i < ddf.size(); i++) {
+      if(ddf[i].degree() <= 0) {
+        continue;
+      }
+      std::vector<Poly<T>> powers(frobenius.size());
+      for(size_t j = 0; j < powers.size(); j++) {
+        powers[j] = frobenius[j] % ddf[i];
+      }
+      std::vector<Poly<T>> factors;
+      equalDegreeFactors(ddf[i], p, i+1, powers, factors);
+      for(auto jt = factors.begin(); jt != factors.end(); jt++) {
+        result.push_back(std::make_pair(*jt, it->second));
+      }
+    }
+  }
+  return result;
+}
+
+/*
+ * Factorizations (see factor) of polys[0], ..., polys[count-1], in the same
+ * order. Each polynom is a task of the pool, idle workers stealing the
+ * remaining ones from the others. The i-th one uses the i-th stream split
+ * from a generator seeded by the one of the thread, so that the factors come
+ * in the same order whatever the scheduling.
+ */
+template <typename T>
+std::vector<std::vector<std::pair<Poly<T>, int>>> factorBatch(const Poly<T> *polys, size_t count, int p, ThreadPool &pool = ThreadPool::instance()) {
+  std::vector<std::vector<std::pair<Poly<T>, int>>> results(count);
+  RandomGenerator streams(RandomGenerator::current().next());
+  auto inContext = coeffsContext(PolyKernel(), static_cast<const T *>(nullptr));
+  parallelFor(pool, 0, count, 1, [&](size_t i) {
+    auto rng = streams.split(i);
+    RandomGeneratorGuard guard(rng);
+    inContext([&]() { results[i] = polys[i].factor(p); });
+  });
+  return results;
+}
+
+template <typename T>
+std::vector<std::vector<std::pair<Poly<T>, int>>> factorBatch(const std::vector<Poly<T>> &polys, int p, ThreadPool &pool = ThreadPool::instance()) {
+  return factorBatch(polys.data(), polys.size(), p, pool);
+}
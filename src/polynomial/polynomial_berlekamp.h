@@ -0,0 +1,129 @@
+#pragma once
+
+/*
+ * Berlekamp's factorization of square free polynomials over GF(p).
+ *
+ * For f of degree n, the polynomials v of degree < n with v^p = v mod f form
+ * a subalgebra of GF(p)[X]/(f) of dimension the number k of irreducible
+ * factors of f: by the chinese remainder theorem, v is a constant modulo each
+ * of them. As v^p is linear in v, this is the kernel of Q - I, where the rows
+ * of the Berlekamp matrix Q are the X^(ip) mod f, found by Gaussian
+ * elimination. Any non constant v of the basis then splits f: f is the
+ * product of the gcd(f, v - s) for s in GF(p). For large p, trying all s is
+ * replaced by gcds with r^((p-1)/2) - 1 for random elements r of the
+ * subalgebra.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_ff.h"
+#include "../finite_fields/finite_fields_linalg.h"
+
+// Factors over GF(p) for p up to this are split deterministically, by trying
+// all the elements of GF(p).
+#ifndef BERLEKAMP_MAX_DETERMINISTIC_PRIME
+#define BERLEKAMP_MAX_DETERMINISTIC_PRIME 256
+#endif
+
+/* n x n matrix whose row i holds the coefficients of X^(ip) mod f, n = deg(f) */
+template <uint64_t p>
+std::vector<FFElem<p>> berlekampMatrix(const Poly<FFElem<p>> &f) {
+  size_t n = f.degree();
+  PolyModulus<FFElem<p>> ctx(f);
+  Poly<FFElem<p>> xp = powmod(Poly<FFElem<p>>::Xn(1), p, ctx);
+  Poly<FFElem<p>> row = ctx.reduce(Poly<FFElem<p>>::Xn(0));
+  std::vector<FFElem<p>> q(n*n);
+  for(size_t i = 0; i < n; i++) {
+    std::copy(row.coeffs_.begin(), row.coeffs_.end(), q.begin() + i*n);
+    row = ctx.mulMod(row, xp);
+  }
+  return q;
+}
+
+/* Monic irreducible factors of the square free polynomial f over GF(p) */
+template <uint64_t p>
+std::vector<Poly<FFElem<p>>> berlekamp(const Poly<FFElem<p>> &f) {
+  typedef FFElem<p> F;
+  std::vector<Poly<F>> factors;
+  Poly<F> g = f;
+  g.simplify();
+  if(g.degree() <= 0) {
+    return factors;
+  }
+  factors.push_back(g / g.coeffs_[g.degree()]);
+  size_t n = g.degree();
+  std::vector<F> q = berlekampMatrix(g);
+  // v Q = v  <=>  (Q - I)^T v = 0
+  std::vector<F> m(n*n);
+  for(size_t i = 0; i < n; i++) {
+    for(size_t j = 0; j < n; j++) {
+      m[j*n+i] = q[i*n+j];
+    }
+    m[i*n+i] -= F(1);
+  }
+  std::vector<std::vector<F>> kernel = ffNullspace(m, n, n);
+  size_t k = kernel.size();
+  std::vector<Poly<F>> basis;
+  for(size_t i = 0; i < k; i++) {
+    Poly<F> v(kernel[i]);
+    v.simplify();
+    if(v.degree() > 0) {
+      basis.push_back(v);
+    }
+  }
+
+  auto unit = Poly<F>::Xn(0);
+  if(p <= BERLEKAMP_MAX_DETERMINISTIC_PRIME) {
+    for(size_t i = 0; i < basis.size() && factors.size() < k; i++) {
+      std::vector<Poly<F>> split;
+      for(auto it = factors.begin(); it != factors.end(); it++) {
+        if(it->degree() == 1) {
+          split.push_back(*it);
+          continue;
+        }
+        // *it is the product of the gcd(*it, v - s)
+        Poly<F> rest = *it;
+        for(uint64_t s = 0; s < p && rest.degree() > 0; s++) {
+          Poly<F> v = basis[i] - Poly<F>({F(s)});
+          Poly<F> h = gcd(rest, v);
+          if(h.degree() > 0) {
+            split.push_back(h);
+            rest = rest / h;
+          }
+        }
+      }
+      factors = split;
+    }
+    return factors;
+  }
+
+  while(factors.size() < k) {
+    // Random element of the subalgebra: without a random constant, r would
+    // only differ by a fixed value modulo two factors, which might then never
+    // be split
+    auto c = Poly<F>::Rand(static_cast<int>(basis.size()) + 1);
+    c.coeffs_.resize(basis.size() + 1);
+    Poly<F> r({c.coeffs_[basis.size()]});
+    for(size_t i = 0; i < basis.size(); i++) {
+      r += c.coeffs_[i] * basis[i];
+    }
+    std::vector<Poly<F>> split;
+    for(auto it = factors.begin(); it != factors.end(); it++) {
+      if(it->degree() == 1) {
+        split.push_back(*it);
+        continue;
+      }
+      PolyModulus<F> ctx(*it);
+      Poly<F> h = gcd(*it, powmod(r, (p-1) / 2, ctx) - unit);
+      if(h.degree() > 0 && h.degree() < it->degree()) {
+        split.push_back(h);
+        split.push_back(*it / h);
+      } else {
+        split.push_back(*it);
+      }
+    }
+    factors = split;
+  }
+  return factors;
+}
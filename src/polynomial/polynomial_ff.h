@@ -0,0 +1,147 @@
+#pragma once
+
+/*
+ * Specialized coefficient kernels for polynomials over prime fields,
+ * Poly<FFElem<n>>, and the hooks needed by Poly<DynFFElem> and
+ * Poly<ExtFFElem<p, k>>. Including this header is enough for Poly<T> to use
+ * them.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "polynomial.h"
+#include "../finite_fields/finite_fields.h"
+#include "../finite_fields/finite_fields_simd.h"
+#include "../finite_fields/finite_fields_runtime.h"
+#include "../finite_fields/finite_fields_extension.h"
+#include "polynomial_ntt.h"
+
+// Products of polynomials with at least this many coefficients use a NTT when
+// n allows it.
+#ifndef POLY_NTT_CUTOFF
+#define POLY_NTT_CUTOFF 256
+#endif
+
+// Lazy reduction is only used when at least this many products can be summed
+// before reducing.
+#define FF_LAZY_MIN_BLOCK 64
+
+template <uint64_t n>
+void coeffsAdd(PolyKernel, FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+  ffAdd(dst, src, len);
+}
+
+template <uint64_t n>
+void coeffsSub(PolyKernel, FFElem<n> *dst, const FFElem<n> *src, size_t len) {
+  ffSub(dst, src, len);
+}
+
+template <uint64_t n>
+void coeffsScale(PolyKernel, FFElem<n> *dst, const FFElem<n> &m, size_t len) {
+  ffScale(dst, m, len);
+}
+
+template <uint64_t n>
+void coeffsAddMul(PolyKernel, FFElem<n> *dst, const FFElem<n> *src, const FFElem<n> &m, size_t len) {
+  ffAddMul(dst, src, m, len);
+}
+
+template <uint64_t n>
+void coeffsInverse(PolyKernel, FFElem<n> *v, size_t len) {
+  batchInverse(v, len);
+}
+
+// Random coefficients are drawn by blocks of this many 64 bits words.
+#define FF_RANDOM_BLOCK 64
+
+/* Uniform coefficients (up to a bias of n / 2^64), reduced from whole words */
+template <uint64_t n>
+void coeffsRandom(PolyKernel, FFElem<n> *dst, size_t len, RandomGenerator &rng) {
+  uint64_t words[FF_RANDOM_BLOCK];
+  for(size_t i = 0; i < len; i += FF_RANDOM_BLOCK) {
+    size_t m = std::min(len - i, size_t(FF_RANDOM_BLOCK));
+    rng.fill(words, m);
+    for(size_t j = 0; j < m; j++) {
+      dst[i+j] = FFElem<n>(words[j]);
+    }
+  }
+}
+
+/*
+ * Schoolbook product with lazy reduction: the products of reduced elements
+ * are summed in a double width accumulator (see ffDot), which is only reduced
+ * when it could overflow, i.e. once per output coefficient for small primes.
+ * b is reversed first so that each output coefficient is a contiguous dot
+ * product.
+ */
+template <uint64_t n>
+void coeffsMulSchoolbook(PolyKernel, FFElem<n> *r, const FFElem<n> *a, size_t na, const FFElem<n> *b, size_t nb) {
+  typedef typename FFElem<n>::wide wide;
+  // Number of terms (each at most (n-1)^2) which can be added to a reduced
+  // accumulator without overflowing.
+  const wide maxTerms = static_cast<wide>(-1) / (static_cast<wide>(n-1) * (n-1)) - 1;
+  const size_t block = maxTerms > SIZE_MAX ? SIZE_MAX : static_cast<size_t>(maxTerms);
+  if(block < FF_LAZY_MIN_BLOCK) {
+    // Large primes: reducing that often is slower than the vectorized rows.
+    coeffsMulSchoolbook<FFElem<n>>(PolyKernel(), r, a, na, b, nb);
+    return;
+  }
+  std::vector<FFElem<n>> rb(b, b+nb);
+  std::reverse(rb.begin(), rb.end());
+  for(size_t k = 0; k < na+nb-1; k++) {
+    // Terms a[i] * b[k-i] = a[i] * rb[nb-1-k+i]
+    size_t i = k >= nb ? k-nb+1 : 0;
+    size_t end = std::min(k, na-1) + 1;
+    wide acc = r[k].value();
+    while(i < end) {
+      size_t len = std::min(end - i, block);
+      acc += ffDot(a + i, rb.data() + (nb-1+i-k), len);
+      acc %= n;
+      i += len;
+    }
+    r[k] = FFElem<n>(static_cast<uint64_t>(acc));
+  }
+}
+
+template <uint64_t n>
+void coeffsMul(PolyKernel, FFElem<n> *r, const FFElem<n> *a, size_t na, const FFElem<n> *b, size_t nb) {
+  if(std::min(na, nb) >= POLY_NTT_CUTOFF && nttSupports<n>(na+nb-1)) {
+    coeffsMulNTT(r, a, na, b, nb);
+    return;
+  }
+  coeffsMul<FFElem<n>>(PolyKernel(), r, a, na, b, nb);
+}
+
+/* Runs the pool tasks of Poly<DynFFElem> with the context of the calling thread */
+inline std::function<void(const std::function<void()> &)> coeffsContext(PolyKernel, const DynFFElem *) {
+  const FFContext *ctx = FFContextGuard::installed();
+  return [ctx](const std::function<void()> &task) {
+    FFContextGuard guard(ctx);
+    task();
+  };
+}
+
+/* Uniform elements of GF(p^k), and not only of the prime subfield */
+template <uint64_t p, unsigned int k>
+void coeffsRandom(PolyKernel, ExtFFElem<p, k> *dst, size_t len, RandomGenerator &rng) {
+  Poly<FFElem<p>> v;
+  v.coeffs_.resize(k);
+  for(size_t i = 0; i < len; i++) {
+    for(unsigned int j = 0; j < k; j++) {
+      v.coeffs_[j] = FFElem<p>(rng.next());
+    }
+    dst[i] = ExtFFElem<p, k>(v);
+  }
+}
+
+/* Runs the pool tasks of Poly<ExtFFElem<p, k>> with the context of the calling thread */
+template <uint64_t p, unsigned int k>
+std::function<void(const std::function<void()> &)> coeffsContext(PolyKernel, const ExtFFElem<p, k> *) {
+  const ExtFFContext<p, k> *ctx = ExtFFContextGuard<p, k>::installed();
+  return [ctx](const std::function<void()> &task) {
+    ExtFFContextGuard<p, k> guard(ctx);
+    task();
+  };
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+/*
+ * Products of real and integer polynomials using complex FFTs in double
+ * precision.
+ *
+ * Both operands are packed in a single complex vector x = a + ib, whose
+ * convolution square x*x has 2 a*b as imaginary part, so that a product costs
+ * one forward and one inverse transform. The error on the result is bounded
+ * using Percival's bound on FFT convolutions ("Rapid multiplication modulo the
+ * sum and difference of highly composite numbers", 2003), which allows integer
+ * products to be certified exact when the bound is small enough. Integer
+ * coefficients too large for that are split in two halves, the three products
+ * of halves being combined as in Karatsuba.
+ *
+ * Transforms are done in place as in polynomial_ntt.h: decimation in frequency
+ * forward, decimation in time inverse, with per level roots of unity cached
+ * for the lifetime of the program.
+ */
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+class FFTRoots {
+  public:
+    static FFTRoots &instance();
+
+    // Computes the roots needed by transforms of length 2^logLen if not done yet
+    void prepare(int logLen);
+    // roots(l)[j] = exp(-2*pi*i*j / 2^(l+1)) for j < 2^l
+    const std::complex<double> *roots(int l) const;
+
+  protected:
+    FFTRoots();
+
+    std::vector<std::complex<double>> roots_[64];
+    // Number of levels for which roots are available
+    std::atomic<int> levels_;
+    std::mutex mutex_;
+};
+
+inline FFTRoots &FFTRoots::instance() {
+  static FFTRoots roots;
+  return roots;
+}
+
+inline FFTRoots::FFTRoots() : levels_(0) {}
+
+inline void FFTRoots::prepare(int logLen) {
+  if(levels_.load(std::memory_order_acquire) >= logLen) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  int levels = levels_.load(std::memory_order_relaxed);
+  for(int l = levels; l < logLen; l++) {
+    // Each root is computed directly (not as a power) to keep them accurate
+    const double pi = std::acos(-1.0);
+    size_t h = size_t(1) << l;
+    roots_[l].resize(h);
+    for(size_t j = 0; j < h; j++) {
+      double angle = -pi * j / h;
+      roots_[l][j] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+  }
+  if(logLen > levels) {
+    levels_.store(logLen, std::memory_order_release);
+  }
+}
+
+inline const std::complex<double> *FFTRoots::roots(int l) const {
+  return roots_[l].data();
+}
+
+/* Plain complex product (std::complex checks for infinities and NaN, which is slow) */
+inline std::complex<double> fftProduct(const std::complex<double> &a, const std::complex<double> &b) {
+  return std::complex<double>(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+}
+
+/* In place transform of a (2^logLen elements), the result being in bit reversed order */
+inline void fftForward(std::complex<double> *a, int logLen, const FFTRoots &roots) {
+  size_t len = size_t(1) << logLen;
+  for(int l = logLen-1; l >= 0; l--) {
+    size_t h = size_t(1) << l;
+    const std::complex<double> *w = roots.roots(l);
+    for(size_t i = 0; i < len; i += 2*h) {
+      for(size_t j = 0; j < h; j++) {
+        std::complex<double> u = a[i+j];
+        std::complex<double> v = a[i+j+h];
+        a[i+j] = u + v;
+        a[i+j+h] = fftProduct(u - v, w[j]);
+      }
+    }
+  }
+}
+
+/* Inverse of fftForward, taking its input in bit reversed order */
+inline void fftInverse(std::complex<double> *a, int logLen, const FFTRoots &roots) {
+  size_t len = size_t(1) << logLen;
+  for(int l = 0; l < logLen; l++) {
+    size_t h = size_t(1) << l;
+    const std::complex<double> *w = roots.roots(l);
+    for(size_t i = 0; i < len; i += 2*h) {
+      for(size_t j = 0; j < h; j++) {
+        std::complex<double> u = a[i+j];
+        std::complex<double> v = fftProduct(a[i+j+h], std::conj(w[j]));
+        a[i+j] = u + v;
+        a[i+j+h] = u - v;
+      }
+    }
+  }
+  double scale = std::ldexp(1.0, -logLen);
+  for(size_t i = 0; i < len; i++) {
+    a[i] *= scale;
+  }
+}
+
+inline int fftLogLength(size_t len) {
+  int logLen = 0;
+  while((size_t(1) << logLen) < len) {
+    logLen++;
+  }
+  return logLen;
+}
+
+inline double fftNorm(const double *a, size_t len) {
+  double norm = 0;
+  for(size_t i = 0; i < len; i++) {
+    norm += a[i] * a[i];
+  }
+  return std::sqrt(norm);
+}
+
+/*
+ * Bound on the error of each coefficient of a product computed by fftMulReal,
+ * for operands of euclidean norms normA and normB. This is Percival's bound
+ * with roots of unity accurate to 3 ulps, times 5/4 for the imperfect balance
+ * of the operands.
+ */
+inline double fftMulErrorBound(double normA, double normB, size_t len) {
+  const double eps = std::ldexp(1.0, -53);
+  const double beta = 3*eps;
+  int logLen = fftLogLength(len);
+  double delta = std::pow(1+eps, 3*logLen) * std::pow(1+eps*std::sqrt(5.0), 3*logLen+1) * std::pow(1+beta, 3*logLen) - 1;
+  return 1.25 * normA * normB * delta;
+}
+
+/* r[k] = sum of a[i] * b[k-i] for k < na+nb-1 */
+inline void fftMulReal(double *r, const double *a, size_t na, const double *b, size_t nb) {
+  int logLen = fftLogLength(na+nb-1);
+  size_t len = size_t(1) << logLen;
+  FFTRoots &roots = FFTRoots::instance();
+  roots.prepare(logLen);
+
+  // Scale a by a power of 2 so that both operands have similar norms, which
+  // keeps the error close to |a| |b| delta instead of (|a|^2 + |b|^2) delta.
+  double normA = fftNorm(a, na);
+  double normB = fftNorm(b, nb);
+  int shift = normA > 0 && normB > 0 ? std::ilogb(normB) - std::ilogb(normA) : 0;
+  std::vector<std::complex<double>> x(len);
+  for(size_t i = 0; i < na; i++) {
+    x[i].real(std::ldexp(a[i], shift));
+  }
+  for(size_t i = 0; i < nb; i++) {
+    x[i].imag(b[i]);
+  }
+  fftForward(x.data(), logLen, roots);
+  for(size_t i = 0; i < len; i++) {
+    x[i] = fftProduct(x[i], x[i]);
+  }
+  fftInverse(x.data(), logLen, roots);
+  for(size_t i = 0; i < na+nb-1; i++) {
+    r[i] = std::ldexp(x[i].imag() / 2, -shift);
+  }
+}
+
+/*
+ * Adds the product of a and b to r if the FFT in double precision can
+ * guarantee an exact result (and the result fits in 64 bits), returns false
+ * without touching r otherwise.
+ */
+inline bool fftMulInt64(int64_t *r, const int64_t *a, size_t na, const int64_t *b, size_t nb) {
+  uint64_t maxA = 0, maxB = 0;
+  for(size_t i = 0; i < na; i++) {
+    maxA = std::max(maxA, a[i] < 0 ? 0 - static_cast<uint64_t>(a[i]) : static_cast<uint64_t>(a[i]));
+  }
+  for(size_t i = 0; i < nb; i++) {
+    maxB = std::max(maxB, b[i] < 0 ? 0 - static_cast<uint64_t>(b[i]) : static_cast<uint64_t>(b[i]));
+  }
+  if(maxA == 0 || maxB == 0) {
+    return true;
+  }
+  if(static_cast<double>(maxA) * static_cast<double>(maxB) * std::min(na, nb) >= std::ldexp(1.0, 62)) {
+    return false;
+  }
+  size_t len = na+nb-1;
+  // Certified exact when the error is below 1/4 (1/2 would do for rounding)
+  const double maxError = 0.25;
+
+  std::vector<double> da(a, a+na), db(b, b+nb);
+  std::vector<double> product(len);
+  if(std::max(maxA, maxB) < (uint64_t(1) << 53) && fftMulErrorBound(fftNorm(da.data(), na), fftNorm(db.data(), nb), len) < maxError) {
+    fftMulReal(product.data(), da.data(), na, db.data(), nb);
+    for(size_t i = 0; i < len; i++) {
+      r[i] += std::llround(product[i]);
+    }
+    return true;
+  }
+
+  // Split coefficients in halves x = hi*2^s + lo with |lo| <= 2^(s-1)
+  int bits = 64 - __builtin_clzll(std::max(maxA, maxB));
+  int s = (bits+1) / 2;
+  std::vector<double> loA(na), hiA(na), sumA(na), loB(nb), hiB(nb), sumB(nb);
+  for(size_t i = 0; i < na; i++) {
+    int64_t hi = (a[i] + (int64_t(1) << (s-1))) >> s;
+    hiA[i] = hi;
+    loA[i] = a[i] - hi * (int64_t(1) << s);
+    sumA[i] = loA[i] + hiA[i];
+  }
+  for(size_t i = 0; i < nb; i++) {
+    int64_t hi = (b[i] + (int64_t(1) << (s-1))) >> s;
+    hiB[i] = hi;
+    loB[i] = b[i] - hi * (int64_t(1) << s);
+    sumB[i] = loB[i] + hiB[i];
+  }
+  if(fftMulErrorBound(fftNorm(loA.data(), na), fftNorm(loB.data(), nb), len) >= maxError ||
+     fftMulErrorBound(fftNorm(hiA.data(), na), fftNorm(hiB.data(), nb), len) >= maxError ||
+     fftMulErrorBound(fftNorm(sumA.data(), na), fftNorm(sumB.data(), nb), len) >= maxError) {
+    return false;
+  }
+  std::vector<double> lo(len), hi(len);
+  fftMulReal(lo.data(), loA.data(), na, loB.data(), nb);
+  fftMulReal(hi.data(), hiA.data(), na, hiB.data(), nb);
+  fftMulReal(product.data(), sumA.data(), na, sumB.data(), nb);
+  for(size_t i = 0; i < len; i++) {
+    // The result fits in 64 bits: wrapping unsigned arithmetic gives it exactly
+    uint64_t l = std::llround(lo[i]);
+    uint64_t h = std::llround(hi[i]);
+    uint64_t m = static_cast<uint64_t>(std::llround(product[i])) - l - h;
+    r[i] += static_cast<int64_t>(l + (m << s) + (h << 2*s));
+  }
+  return true;
+}
@@ -0,0 +1,439 @@
+#pragma once
+
+/*
+ * Multi-modular products of polynomials with big integer coefficients:
+ * boost::multiprecision integers and boost::rational. Including this header
+ * is enough for Poly<T> to use them.
+ *
+ * The coefficients of a product being bounded by min(na, nb) |a|max |b|max,
+ * they are determined by their residues modulo enough word size primes. The
+ * product is computed modulo primes p = c*2^20 + 1 with a NTT for each, then
+ * its coefficients are rebuilt by the chinese remainder theorem (Garner's
+ * algorithm). Rational coefficients are first brought to a common
+ * denominator. Products whose coefficients need more bits than the primes
+ * provide fall back to the generic product.
+ *
+ * Gcds of such polynomials are computed in the same way, from their images in
+ * GF(p)[X] (Brown's modular algorithm), which avoids the growth of the
+ * coefficients along the remainder sequence.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/rational.hpp>
+#include <boost/multiprecision/gmp.hpp>
+#include "polynomial.h"
+#include "polynomial_ff.h"
+#include "polynomial_ntt.h"
+
+// Products of polynomials with at least this many coefficients use the
+// multi-modular algorithm.
+#ifndef POLY_MULTIMODULAR_CUTOFF
+#define POLY_MULTIMODULAR_CUTOFF 64
+#endif
+
+// Primes between 2^30 and 2^31 of the form c*2^20 + 1, allowing products of
+// up to 2^20 coefficients with up to 30*32 bits.
+constexpr uint64_t multiModularPrimes[] = {
+  2130706433, 2114977793, 2113929217, 2099249153, 2095054849, 2088763393, 2077229057, 2070937601,
+  2047868929, 2035286017, 2025848833, 2013265921, 1998585857, 1978662913, 1963982849, 1953497089,
+  1945108481, 1931476993, 1922039809, 1894776833, 1893728257, 1888485377, 1868562433, 1866465281,
+  1863319553, 1835008001, 1811939329, 1790967809, 1724907521, 1711276033, 1709178881, 1699741697,
+};
+constexpr size_t multiModularPrimeCount = sizeof(multiModularPrimes) / sizeof(multiModularPrimes[0]);
+
+/* Products up to 2^multiModularMaxLog() coefficients have an NTT for all the primes from the i-th one */
+constexpr int multiModularMaxLog(size_t i = 0) {
+  return i + 1 == multiModularPrimeCount ? nttTrailingZeros(multiModularPrimes[i] - 1) :
+    std::min(nttTrailingZeros(multiModularPrimes[i] - 1), multiModularMaxLog(i + 1));
+}
+
+typedef void (*MultiModularProduct)(uint32_t *r, const uint32_t *a, size_t na, const uint32_t *b, size_t nb);
+
+/* r = a*b mod p, all coefficients being reduced */
+template <uint64_t p>
+void multiModularProduct(uint32_t *r, const uint32_t *a, size_t na, const uint32_t *b, size_t nb) {
+  std::vector<FFElem<p>> fa(na), fb(nb), fr(na+nb-1);
+  for(size_t i = 0; i < na; i++) {
+    fa[i] = FFElem<p>(uint64_t(a[i]));
+  }
+  for(size_t i = 0; i < nb; i++) {
+    fb[i] = FFElem<p>(uint64_t(b[i]));
+  }
+  coeffsMulNTT(fr.data(), fa.data(), na, fb.data(), nb);
+  for(size_t i = 0; i < na+nb-1; i++) {
+    r[i] = fr[i].value();
+  }
+}
+
+template <size_t... I>
+const MultiModularProduct *multiModularProducts(std::index_sequence<I...>) {
+  static const MultiModularProduct products[] = {&multiModularProduct<multiModularPrimes[I]>...};
+  return products;
+}
+
+/* x^-1 mod p for p prime */
+inline uint64_t multiModularInverse(uint64_t x, uint64_t p) {
+  uint64_t result = 1;
+  x %= p;
+  for(uint64_t e = p-2; e > 0; e >>= 1) {
+    if(e & 1) {
+      result = result * x % p;
+    }
+    x = x * x % p;
+  }
+  return result;
+}
+
+inline size_t multiModularMaxBits(const boost::multiprecision::mpz_int *a, size_t len) {
+  size_t bits = 0;
+  for(size_t i = 0; i < len; i++) {
+    bits = std::max(bits, mpz_sizeinbase(a[i].backend().data(), 2));
+  }
+  return bits;
+}
+
+/*
+ * Adds the product of a and b to r, returns false without touching r when it
+ * needs too many primes or is too long for their NTT.
+ */
+inline bool multiModularMul(boost::multiprecision::mpz_int *r, const boost::multiprecision::mpz_int *a, size_t na, const boost::multiprecision::mpz_int *b, size_t nb) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  size_t len = na+nb-1;
+  // |result| < 2^bits, the sign needing one more bit
+  size_t bits = multiModularMaxBits(a, na) + multiModularMaxBits(b, nb) + 2;
+  for(size_t n = std::min(na, nb); n > 1; n = (n+1) / 2) {
+    bits++;
+  }
+  size_t k = (bits + 29) / 30;
+  if(k > multiModularPrimeCount || len > (size_t(1) << multiModularMaxLog())) {
+    return false;
+  }
+
+  const MultiModularProduct *products = multiModularProducts(std::make_index_sequence<multiModularPrimeCount>());
+  std::vector<uint32_t> ra(na), rb(nb);
+  std::vector<uint32_t> images(k*len);
+  for(size_t j = 0; j < k; j++) {
+    for(size_t i = 0; i < na; i++) {
+      ra[i] = mpz_fdiv_ui(a[i].backend().data(), multiModularPrimes[j]);
+    }
+    for(size_t i = 0; i < nb; i++) {
+      rb[i] = mpz_fdiv_ui(b[i].backend().data(), multiModularPrimes[j]);
+    }
+    products[j](images.data() + j*len, ra.data(), na, rb.data(), nb);
+  }
+
+  // Garner: x = v0 + p0 (v1 + p1 (v2 + ...)) with 0 <= vj < pj
+  std::vector<uint64_t> inverses(k*k);
+  for(size_t j = 0; j < k; j++) {
+    for(size_t i = 0; i < j; i++) {
+      inverses[j*k+i] = multiModularInverse(multiModularPrimes[i], multiModularPrimes[j]);
+    }
+  }
+  mpz_int modulus = 1;
+  for(size_t j = 0; j < k; j++) {
+    modulus *= multiModularPrimes[j];
+  }
+  mpz_int half = modulus / 2;
+  std::vector<uint64_t> v(k);
+  mpz_int x;
+  for(size_t c = 0; c < len; c++) {
+    for(size_t j = 0; j < k; j++) {
+      uint64_t p = multiModularPrimes[j];
+      uint64_t t = images[j*len+c];
+      for(size_t i = 0; i < j; i++) {
+        t = (t + p - v[i] % p) * inverses[j*k+i] % p;
+      }
+      v[j] = t;
+    }
+    x = v[k-1];
+    for(size_t j = k-1; j > 0; j--) {
+      x *= multiModularPrimes[j-1];
+      x += v[j-1];
+    }
+    if(x > half) {
+      x -= modulus;
+    }
+    r[c] += x;
+  }
+  return true;
+}
+
+inline void coeffsMul(PolyKernel, boost::multiprecision::mpz_int *r, const boost::multiprecision::mpz_int *a, size_t na, const boost::multiprecision::mpz_int *b, size_t nb) {
+  if(std::min(na, nb) >= POLY_MULTIMODULAR_CUTOFF && multiModularMul(r, a, na, b, nb)) {
+    return;
+  }
+  coeffsMul<boost::multiprecision::mpz_int>(PolyKernel(), r, a, na, b, nb);
+}
+
+/* Other boost::multiprecision integers (e.g. cpp_int, int512_t) go through mpz_int */
+template <class Backend, boost::multiprecision::expression_template_option ET>
+typename std::enable_if<boost::multiprecision::number_category<Backend>::value == boost::multiprecision::number_kind_integer>::type
+coeffsMul(PolyKernel, boost::multiprecision::number<Backend, ET> *r, const boost::multiprecision::number<Backend, ET> *a, size_t na, const boost::multiprecision::number<Backend, ET> *b, size_t nb) {
+  typedef boost::multiprecision::number<Backend, ET> Number;
+  typedef boost::multiprecision::mpz_int mpz_int;
+  if(std::min(na, nb) >= POLY_MULTIMODULAR_CUTOFF) {
+    std::vector<mpz_int> za(a, a+na), zb(b, b+nb), product(na+nb-1);
+    size_t bits = multiModularMaxBits(za.data(), na) + multiModularMaxBits(zb.data(), nb);
+    for(size_t n = std::min(na, nb); n > 1; n = (n+1) / 2) {
+      bits++;
+    }
+    // Fixed size integers: only when the result can't overflow
+    bool fits = !std::numeric_limits<Number>::is_bounded || bits < static_cast<size_t>(std::numeric_limits<Number>::digits);
+    if(fits && multiModularMul(product.data(), za.data(), na, zb.data(), nb)) {
+      for(size_t i = 0; i < product.size(); i++) {
+        r[i] += Number(product[i]);
+      }
+      return;
+    }
+  }
+  coeffsMul<Number>(PolyKernel(), r, a, na, b, nb);
+}
+
+/* Sets z to a times the lcm of its denominators, which is returned */
+template <typename I>
+boost::multiprecision::mpz_int multiModularNumerators(std::vector<boost::multiprecision::mpz_int> &z, const boost::rational<I> *a, size_t na) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  mpz_int d = 1;
+  for(size_t i = 0; i < na; i++) {
+    d = lcm(d, mpz_int(a[i].denominator()));
+  }
+  z.resize(na);
+  for(size_t i = 0; i < na; i++) {
+    z[i] = mpz_int(a[i].numerator()) * (d / mpz_int(a[i].denominator()));
+  }
+  return d;
+}
+
+/* Rationals: integer product of the numerators brought to a common denominator */
+template <typename I>
+void coeffsMul(PolyKernel, boost::rational<I> *r, const boost::rational<I> *a, size_t na, const boost::rational<I> *b, size_t nb) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  if(std::min(na, nb) >= POLY_MULTIMODULAR_CUTOFF) {
+    std::vector<mpz_int> za, zb, product(na+nb-1);
+    mpz_int da = multiModularNumerators(za, a, na);
+    mpz_int db = multiModularNumerators(zb, b, nb);
+    if(multiModularMul(product.data(), za.data(), na, zb.data(), nb)) {
+      mpz_int d = da * db;
+      for(size_t i = 0; i < product.size(); i++) {
+        mpz_int g = gcd(product[i], d);
+        r[i] += boost::rational<I>(static_cast<I>(product[i] / g), static_cast<I>(d / g));
+      }
+      return;
+    }
+  }
+  coeffsMul<boost::rational<I>>(PolyKernel(), r, a, na, b, nb);
+}
+
+typedef void (*ModularGcdImage)(std::vector<uint32_t> &g, const std::vector<uint32_t> &a, const std::vector<uint32_t> &b);
+
+/* g = gcd(a, b) mod p (monic), all coefficients being reduced */
+template <uint64_t p>
+void modularGcdImage(std::vector<uint32_t> &g, const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+  Poly<FFElem<p>> fa, fb;
+  for(size_t i = 0; i < a.size(); i++) {
+    fa.coeffs_.push_back(FFElem<p>(uint64_t(a[i])));
+  }
+  for(size_t i = 0; i < b.size(); i++) {
+    fb.coeffs_.push_back(FFElem<p>(uint64_t(b[i])));
+  }
+  Poly<FFElem<p>> fg = gcd(fa, fb);
+  g.resize(fg.coeffs_.size());
+  for(size_t i = 0; i < g.size(); i++) {
+    g[i] = fg.coeffs_[i].value();
+  }
+}
+
+template <size_t... I>
+const ModularGcdImage *modularGcdImages(std::index_sequence<I...>) {
+  static const ModularGcdImage images[] = {&modularGcdImage<multiModularPrimes[I]>...};
+  return images;
+}
+
+/* Divides a by its content (the gcd of its coefficients) and returns it, the leading coefficient becoming positive */
+inline boost::multiprecision::mpz_int primitivePart(Poly<boost::multiprecision::mpz_int> &a) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  mpz_int content = 0;
+  for(size_t i = 0; i < a.coeffs_.size(); i++) {
+    content = gcd(content, a.coeffs_[i]);
+  }
+  if(content == 0) {
+    return content;
+  }
+  if(a.coeffs_[a.degree()] < 0) {
+    content = -content;
+  }
+  for(size_t i = 0; i < a.coeffs_.size(); i++) {
+    mpz_divexact(a.coeffs_[i].backend().data(), a.coeffs_[i].backend().data(), content.backend().data());
+  }
+  return content;
+}
+
+/* Whether d divides a in Z[X] */
+inline bool integerDivides(const Poly<boost::multiprecision::mpz_int> &d, Poly<boost::multiprecision::mpz_int> a) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  const mpz_int &lead = d.coeffs_[d.degree()];
+  mpz_int q;
+  while(a.degree() >= d.degree()) {
+    int n = a.degree() - d.degree();
+    if(!mpz_divisible_p(a.coeffs_[a.degree()].backend().data(), lead.backend().data())) {
+      return false;
+    }
+    q = -(a.coeffs_[a.degree()] / lead);
+    coeffsAddMul(PolyKernel(), a.coeffs_.data() + n, d.coeffs_.data(), q, d.coeffs_.size());
+    a.simplify();
+  }
+  return a.null();
+}
+
+/*
+ * gcd of a and b in Z[X], with a positive leading coefficient. The gcd of the
+ * primitive parts of a and b is rebuilt by the chinese remainder theorem from
+ * its images modulo primes not dividing their leading coefficients, scaled to
+ * have the gcd of these leading coefficients as leading coefficient. Primes
+ * giving an image of too high a degree are skipped. The result is checked by
+ * trial division once it stops changing when adding primes. When the primes
+ * are exhausted, the gcd is computed over Q.
+ */
+inline Poly<boost::multiprecision::mpz_int> integerGcd(Poly<boost::multiprecision::mpz_int> a, Poly<boost::multiprecision::mpz_int> b) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  a.simplify();
+  b.simplify();
+  if(a.null() || b.null()) {
+    Poly<mpz_int> g = a.null() ? b : a;
+    if(!g.null() && g.coeffs_[g.degree()] < 0) {
+      g = Poly<mpz_int>() - g;
+    }
+    return g;
+  }
+  mpz_int content = gcd(primitivePart(a), primitivePart(b));
+  const mpz_int &leadA = a.coeffs_[a.degree()];
+  const mpz_int &leadB = b.coeffs_[b.degree()];
+  mpz_int gamma = gcd(leadA, leadB);
+
+  const ModularGcdImage *images = modularGcdImages(std::make_index_sequence<multiModularPrimeCount>());
+  std::vector<uint32_t> ra(a.coeffs_.size()), rb(b.coeffs_.size()), image;
+  // Coefficients of h are in [0, modulus), those of candidate in the symmetric range
+  Poly<mpz_int> h, candidate, previous;
+  mpz_int modulus, t;
+  int degree = std::min(a.degree(), b.degree());
+  for(size_t j = 0; j < multiModularPrimeCount; j++) {
+    uint64_t p = multiModularPrimes[j];
+    if(mpz_fdiv_ui(leadA.backend().data(), p) == 0 || mpz_fdiv_ui(leadB.backend().data(), p) == 0) {
+      continue;
+    }
+    for(size_t i = 0; i < ra.size(); i++) {
+      ra[i] = mpz_fdiv_ui(a.coeffs_[i].backend().data(), p);
+    }
+    for(size_t i = 0; i < rb.size(); i++) {
+      rb[i] = mpz_fdiv_ui(b.coeffs_[i].backend().data(), p);
+    }
+    images[j](image, ra, rb);
+    int d = image.size() - 1;
+    if(d == 0) {
+      return Poly<mpz_int>({content});
+    }
+    if(d > degree) {
+      // Unlucky prime
+      continue;
+    }
+    uint64_t g = mpz_fdiv_ui(gamma.backend().data(), p);
+    if(d < degree || h.null()) {
+      // All the previous primes were unlucky
+      degree = d;
+      h.coeffs_.assign(d+1, 0);
+      for(int i = 0; i <= d; i++) {
+        h.coeffs_[i] = image[i] * g % p;
+      }
+      modulus = p;
+      previous = Poly<mpz_int>();
+    } else {
+      uint64_t inverse = multiModularInverse(mpz_fdiv_ui(modulus.backend().data(), p), p);
+      for(int i = 0; i <= d; i++) {
+        uint64_t x = image[i] * g % p;
+        uint64_t y = mpz_fdiv_ui(h.coeffs_[i].backend().data(), p);
+        t = (x + p - y) * inverse % p;
+        h.coeffs_[i] += modulus * t;
+      }
+      modulus *= p;
+    }
+    mpz_int half = modulus / 2;
+    candidate = h;
+    for(int i = 0; i <= d; i++) {
+      if(candidate.coeffs_[i] > half) {
+        candidate.coeffs_[i] -= modulus;
+      }
+    }
+    if(candidate == previous) {
+      Poly<mpz_int> g = candidate;
+      primitivePart(g);
+      if(integerDivides(g, a) && integerDivides(g, b)) {
+        coeffsScale(PolyKernel(), g.coeffs_.data(), content, g.coeffs_.size());
+        return g;
+      }
+    }
+    previous = candidate;
+  }
+
+  // Coefficients too large for the primes: gcd over Q
+  typedef boost::rational<mpz_int> Q;
+  Poly<Q> qa, qb;
+  for(size_t i = 0; i < a.coeffs_.size(); i++) {
+    qa.coeffs_.push_back(Q(a.coeffs_[i]));
+  }
+  for(size_t i = 0; i < b.coeffs_.size(); i++) {
+    qb.coeffs_.push_back(Q(b.coeffs_[i]));
+  }
+  Poly<Q> qg = gcd<Q>(qa, qb);
+  std::vector<mpz_int> zg;
+  multiModularNumerators(zg, qg.coeffs_.data(), qg.coeffs_.size());
+  Poly<mpz_int> g(zg);
+  primitivePart(g);
+  coeffsScale(PolyKernel(), g.coeffs_.data(), content, g.coeffs_.size());
+  return g;
+}
+
+/* Boost integers: gcd in Z[X], with a positive leading coefficient */
+template <class Backend, boost::multiprecision::expression_template_option ET>
+typename std::enable_if<boost::multiprecision::number_category<Backend>::value == boost::multiprecision::number_kind_integer, Poly<boost::multiprecision::number<Backend, ET>>>::type
+gcd(Poly<boost::multiprecision::number<Backend, ET>> a, Poly<boost::multiprecision::number<Backend, ET>> b) {
+  typedef boost::multiprecision::number<Backend, ET> Number;
+  typedef boost::multiprecision::mpz_int mpz_int;
+  Poly<mpz_int> za, zb;
+  for(size_t i = 0; i < a.coeffs_.size(); i++) {
+    za.coeffs_.push_back(mpz_int(a.coeffs_[i]));
+  }
+  for(size_t i = 0; i < b.coeffs_.size(); i++) {
+    zb.coeffs_.push_back(mpz_int(b.coeffs_[i]));
+  }
+  Poly<mpz_int> zg = integerGcd(za, zb);
+  Poly<Number> g;
+  for(size_t i = 0; i < zg.coeffs_.size(); i++) {
+    g.coeffs_.push_back(Number(zg.coeffs_[i]));
+  }
+  return g;
+}
+
+/* Rationals: monic gcd, computed from the gcd of the numerators brought to a common denominator */
+template <typename I>
+Poly<boost::rational<I>> gcd(Poly<boost::rational<I>> a, Poly<boost::rational<I>> b) {
+  typedef boost::multiprecision::mpz_int mpz_int;
+  std::vector<mpz_int> za, zb;
+  multiModularNumerators(za, a.coeffs_.data(), a.coeffs_.size());
+  multiModularNumerators(zb, b.coeffs_.data(), b.coeffs_.size());
+  Poly<mpz_int> zg = integerGcd(Poly<mpz_int>(za), Poly<mpz_int>(zb));
+  Poly<boost::rational<I>> g;
+  if(zg.null()) {
+    return g;
+  }
+  const mpz_int &lead = zg.coeffs_[zg.degree()];
+  for(size_t i = 0; i < zg.coeffs_.size(); i++) {
+    mpz_int d = gcd(zg.coeffs_[i], lead);
+    g.coeffs_.push_back(boost::rational<I>(static_cast<I>(zg.coeffs_[i] / d), static_cast<I>(lead / d)));
+  }
+  return g;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+/*
+ * Number theoretic transform (NTT) products for Poly<FFElem<p>> when
+ * p = c*2^k + 1: GF(p) then has primitive 2^j-th roots of unity for all
+ * j <= k, so that products of total length up to 2^k can be computed in
+ * O(n log n) with a FFT over GF(p).
+ *
+ * The forward transform is a decimation in frequency, leaving its output in
+ * bit reversed order, and the inverse one a decimation in time taking its
+ * input in that order, so that no bit reversal permutation is needed. The
+ * roots of unity used by each level of butterflies are stored contiguously.
+ * They are computed the first time a transform of this length is needed and
+ * cached for the lifetime of the program, once per prime.
+ */
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "../finite_fields/finite_fields.h"
+#include "../finite_fields/finite_fields_simd.h"
+
+// Butterflies on blocks at least twice this long use the batch kernels
+#define NTT_BATCH_MIN_HALF 16
+
+constexpr int nttTrailingZeros(uint64_t x) {
+  return x == 0 || x % 2 == 1 ? 0 : 1 + nttTrailingZeros(x / 2);
+}
+
+template <uint64_t p>
+FFElem<p> nttPower(FFElem<p> x, uint64_t e) {
+  FFElem<p> result(1);
+  for(; e > 0; e >>= 1) {
+    if(e & 1) {
+      result *= x;
+    }
+    x *= x;
+  }
+  return result;
+}
+
+template <uint64_t p>
+class NTTTables {
+  public:
+    // Transforms are possible for lengths up to 2^maxLog
+    static const int maxLog = nttTrailingZeros(p-1);
+
+    static NTTTables<p> &instance();
+
+    // Computes the roots needed by transforms of length 2^logLen if not done yet
+    void prepare(int logLen);
+    // roots(l)[j] = w^j for j < 2^l, w being a primitive 2^(l+1)-th root of unity
+    const FFElem<p> *roots(int l) const;
+    const FFElem<p> *inverseRoots(int l) const;
+
+  protected:
+    NTTTables();
+
+    // Primitive 2^maxLog-th root of unity
+    FFElem<p> root_;
+    std::vector<FFElem<p>> roots_[64];
+    std::vector<FFElem<p>> inverseRoots_[64];
+    // Number of levels for which roots are available
+    std::atomic<int> levels_;
+    std::mutex mutex_;
+};
+
+template <uint64_t p>
+NTTTables<p> &NTTTables<p>::instance() {
+  static NTTTables<p> tables;
+  return tables;
+}
+
+template <uint64_t p>
+NTTTables<p>::NTTTables() : levels_(0) {
+  if(maxLog == 0) {
+    return;
+  }
+  // x^c is a 2^maxLog-th root of unity, primitive iff x is not a square
+  for(uint64_t x = 2; x < p; x++) {
+    if(nttPower(FFElem<p>(x), (p-1) / 2) == FFElem<p>(-1)) {
+      root_ = nttPower(FFElem<p>(x), (p-1) >> maxLog);
+      return;
+    }
+  }
+  std::cerr << "Oups, no root of unity found in GF(" << p << "): " << p << " is not prime !!!" << std::endl;
+}
+
+template <uint64_t p>
+void NTTTables<p>::prepare(int logLen) {
+  assert(logLen <= maxLog);
+  if(levels_.load(std::memory_order_acquire) >= logLen) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  int levels = levels_.load(std::memory_order_relaxed);
+  for(int l = levels; l < logLen; l++) {
+    FFElem<p> w = nttPower(root_, uint64_t(1) << (maxLog-l-1));
+    FFElem<p> iw = w.inverse();
+    roots_[l].resize(size_t(1) << l);
+    inverseRoots_[l].resize(size_t(1) << l);
+    roots_[l][0] = inverseRoots_[l][0] = FFElem<p>(1);
+    for(size_t j = 1; j < roots_[l].size(); j++) {
+      roots_[l][j] = roots_[l][j-1] * w;
+      inverseRoots_[l][j] = inverseRoots_[l][j-1] * iw;
+    }
+  }
+  if(logLen > levels) {
+    levels_.store(logLen, std::memory_order_release);
+  }
+}
+
+template <uint64_t p>
+const FFElem<p> *NTTTables<p>::roots(int l) const {
+  return roots_[l].data();
+}
+
+template <uint64_t p>
+const FFElem<p> *NTTTables<p>::inverseRoots(int l) const {
+  return inverseRoots_[l].data();
+}
+
+/* Whether an NTT of length at least len exists in GF(p) */
+template <uint64_t p>
+bool nttSupports(size_t len) {
+  return NTTTables<p>::maxLog > 0 && len <= (uint64_t(1) << NTTTables<p>::maxLog);
+}
+
+/*
+ * In place transform of a (2^logLen elements), the result being in bit
+ * reversed order. Butterflies of large levels are done on whole halves of
+ * blocks with the batch kernels, using tmp (2^(logLen-1) elements).
+ */
+template <uint64_t p>
+void nttForward(FFElem<p> *a, int logLen, const NTTTables<p> &tables, FFElem<p> *tmp) {
+  size_t len = size_t(1) << logLen;
+  for(int l = logLen-1; l >= 0; l--) {
+    size_t h = size_t(1) << l;
+    const FFElem<p> *w = tables.roots(l);
+    for(size_t i = 0; i < len; i += 2*h) {
+      FFElem<p> *u = a+i;
+      FFElem<p> *v = a+i+h;
+      if(h >= NTT_BATCH_MIN_HALF) {
+        std::copy(u, u+h, tmp);
+        ffAdd(u, v, h);
+        ffSub(tmp, v, h);
+        ffMul(tmp, w, h);
+        std::copy(tmp, tmp+h, v);
+        continue;
+      }
+      for(size_t j = 0; j < h; j++) {
+        FFElem<p> x = u[j];
+        u[j] += v[j];
+        v[j] = (x - v[j]) * w[j];
+      }
+    }
+  }
+}
+
+/* Inverse of nttForward, taking its input in bit reversed order */
+template <uint64_t p>
+void nttInverse(FFElem<p> *a, int logLen, const NTTTables<p> &tables, FFElem<p> *tmp) {
+  size_t len = size_t(1) << logLen;
+  for(int l = 0; l < logLen; l++) {
+    size_t h = size_t(1) << l;
+    const FFElem<p> *w = tables.inverseRoots(l);
+    for(size_t i = 0; i < len; i += 2*h) {
+      FFElem<p> *u = a+i;
+      FFElem<p> *v = a+i+h;
+      if(h >= NTT_BATCH_MIN_HALF) {
+        ffMul(v, w, h);
+        std::copy(u, u+h, tmp);
+        ffAdd(u, v, h);
+        ffSub(tmp, v, h);
+        std::copy(tmp, tmp+h, v);
+        continue;
+      }
+      for(size_t j = 0; j < h; j++) {
+        FFElem<p> x = u[j];
+        FFElem<p> y = v[j] * w[j];
+        u[j] = x + y;
+        v[j] = x - y;
+      }
+    }
+  }
+  ffScale(a, FFElem<p>(uint64_t(len)).inverse(), len);
+}
+
+/* Adds the product of a and b to r, nttSupports<p>(na+nb-1) being true */
+template <uint64_t p>
+void coeffsMulNTT(FFElem<p> *r, const FFElem<p> *a, size_t na, const FFElem<p> *b, size_t nb) {
+  int logLen = 0;
+  while((size_t(1) << logLen) < na+nb-1) {
+    logLen++;
+  }
+  assert(logLen <= NTTTables<p>::maxLog);
+  size_t len = size_t(1) << logLen;
+  NTTTables<p> &tables = NTTTables<p>::instance();
+  tables.prepare(logLen);
+
+  std::vector<FFElem<p>> fa(len);
+  std::vector<FFElem<p>> tmp(len/2);
+  std::copy(a, a+na, fa.begin());
+  nttForward(fa.data(), logLen, tables, tmp.data());
+  if(a == b && na == nb) {
+    // Squaring: a single forward transform
+    ffMul(fa.data(), fa.data(), len);
+  } else {
+    std::vector<FFElem<p>> fb(len);
+    std::copy(b, b+nb, fb.begin());
+    nttForward(fb.data(), logLen, tables, tmp.data());
+    ffMul(fa.data(), fb.data(), len);
+  }
+  nttInverse(fa.data(), logLen, tables, tmp.data());
+  ffAdd(r, fa.data(), na+nb-1);
+}
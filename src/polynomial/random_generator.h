@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+ * xoshiro256** pseudo random generator (Blackman and Vigna), seeded with
+ * splitmix64: 64 random bits per call, and reproducible from its seed.
+ *
+ * Each thread has a current generator, used by Poly::Rand, G2Poly::Rand and
+ * the randomized algorithms. It is seeded in the order in which threads first
+ * use it (the first one getting seed 0), unless another generator is installed
+ * with a RandomGeneratorGuard. Parallel algorithms give each of their tasks or
+ * trials a generator obtained with split() from the one of the calling thread,
+ * so that their results only depend on its seed and not on the scheduling.
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class RandomGenerator {
+  public:
+    explicit RandomGenerator(uint64_t seed = 0);
+
+    void seed(uint64_t seed);
+    uint64_t next();
+    // Fills words with random bits
+    void fill(uint64_t *words, size_t n);
+    // Generator of the index-th stream derived from the state of this one
+    RandomGenerator split(uint64_t index) const;
+
+    // Generator of the calling thread
+    static RandomGenerator &current();
+
+  protected:
+    friend class RandomGeneratorGuard;
+
+    static RandomGenerator *&installed();
+
+    uint64_t s_[4];
+};
+
+/*
+ * Installs a generator as the current one of the calling thread for the
+ * lifetime of the guard, restoring the previous one afterwards.
+ */
+class RandomGeneratorGuard {
+  public:
+    RandomGeneratorGuard(RandomGenerator &rng);
+    ~RandomGeneratorGuard();
+
+    RandomGeneratorGuard(const RandomGeneratorGuard &) = delete;
+    RandomGeneratorGuard &operator=(const RandomGeneratorGuard &) = delete;
+
+  protected:
+    RandomGenerator *previous_;
+};
+
+inline uint64_t splitMix64(uint64_t &x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+inline RandomGenerator::RandomGenerator(uint64_t seed) {
+  this->seed(seed);
+}
+
+inline void RandomGenerator::seed(uint64_t seed) {
+  for(int i = 0; i < 4; i++) {
+    s_[i] = splitMix64(seed);
+  }
+}
+
+inline uint64_t RandomGenerator::next() {
+  auto rotl = [](uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+  uint64_t result = rotl(s_[1] * 5, 7) * 9;
+  uint64_t t = s_[1] << 17;
+  s_[2] ^= s_[0];
+  s_[3] ^= s_[1];
+  s_[1] ^= s_[2];
+  s_[0] ^= s_[3];
+  s_[2] ^= t;
+  s_[3] = rotl(s_[3], 45);
+  return result;
+}
+
+inline void RandomGenerator::fill(uint64_t *words, size_t n) {
+  for(size_t i = 0; i < n; i++) {
+    words[i] = next();
+  }
+}
+
+inline RandomGenerator RandomGenerator::split(uint64_t index) const {
+  uint64_t x = index;
+  for(int i = 0; i < 4; i++) {
+    x ^= s_[i];
+    x = splitMix64(x);
+  }
+  return RandomGenerator(x);
+}
+
+inline RandomGenerator *&RandomGenerator::installed() {
+  thread_local RandomGenerator *rng = nullptr;
+  return rng;
+}
+
+inline RandomGenerator &RandomGenerator::current() {
+  static std::atomic<uint64_t> threads(0);
+  thread_local RandomGenerator own(threads++);
+  RandomGenerator *rng = installed();
+  return rng ? *rng : own;
+}
+
+inline RandomGeneratorGuard::RandomGeneratorGuard(RandomGenerator &rng) {
+  previous_ = RandomGenerator::installed();
+  RandomGenerator::installed() = &rng;
+}
+
+inline RandomGeneratorGuard::~RandomGeneratorGuard() {
+  RandomGenerator::installed() = previous_;
+}
@@ -580,4 +580,177 @@ BOOST_AUTO_TEST_CASE( test_cantor_zassenhaus_on_nintendo_3 )
 }
 */
 
+BOOST_AUTO_TEST_CASE( test_factor_on_nintendo_1 )
+{
+  // 73AF = 111001110101111 
+  G2Poly a({1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1});
+  // 83 = 10000011
+  G2Poly f1({1, 1, 0, 0, 0, 0, 0, 1});
+  // E5 = 11100101
+  G2Poly f2({1, 0, 1, 0, 0, 1, 1, 1});
+
+  auto result = a.factor(2);
+
+  BOOST_CHECK_EQUAL(result.size(), 2);
+  BOOST_CHECK(result[0].first == f1 || result[0].first == f2);
+  BOOST_CHECK(result[1].first == f1 || result[1].first == f2);
+  BOOST_CHECK(result[0].first != result[1].first);
+  BOOST_CHECK_EQUAL(result[0].second, 1);
+  BOOST_CHECK_EQUAL(result[1].second, 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_factor_with_multiplicities )
+{
+  // (X^3 + X + 1)^2 (X + 1)^5 X^4
+  G2Poly c({1, 1, 0, 1});
+  G2Poly x1({1, 1});
+  auto a = c * c * x1 * x1 * x1 * x1 * x1 * G2Poly::Xn(4);
+
+  auto result = a.factor(2);
+
+  std::sort(result.begin(), result.end(), [](const std::pair<G2Poly, uint64_t>& lhs, const std::pair<G2Poly, uint64_t>& rhs) { return lhs.second < rhs.second; } );
+  BOOST_CHECK_EQUAL(result.size(), 3);
+  BOOST_CHECK_EQUAL(result[0].first, c);
+  BOOST_CHECK_EQUAL(result[0].second, 2);
+  BOOST_CHECK_EQUAL(result[1].first, G2Poly::Xn(1));
+  BOOST_CHECK_EQUAL(result[1].second, 4);
+  BOOST_CHECK_EQUAL(result[2].first, x1);
+  BOOST_CHECK_EQUAL(result[2].second, 5);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_equal_degree_factorize_on_nintendo_1 )
+{
+  ThreadPool pool(4);
+  // 73AF = 111001110101111 
+  G2Poly a({1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1});
+  // 83 = 10000011
+  G2Poly f1({1, 1, 0, 0, 0, 0, 0, 1});
+  // E5 = 11100101
+  G2Poly f2({1, 0, 1, 0, 0, 1, 1, 1});
+
+  auto result = a.equalDegreeFactorize(2, 7, pool);
+
+  BOOST_CHECK(result == f1 || result == f2);
+}
+
+BOOST_AUTO_TEST_CASE( test_factor_batch )
+{
+  ThreadPool pool(4);
+  // 73AF = 111001110101111 
+  G2Poly a({1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1});
+  // (X^3 + X + 1)^2 (X + 1)^5 X^4
+  G2Poly c({1, 1, 0, 1});
+  G2Poly x1({1, 1});
+  auto b = c * c * x1 * x1 * x1 * x1 * x1 * G2Poly::Xn(4);
+  std::vector<G2Poly> polys;
+  for(int i = 0; i < 50; i++) {
+    polys.push_back(i % 2 ? a : b);
+  }
+
+  auto results = factorBatch(polys, 2, pool);
+
+  BOOST_CHECK_EQUAL(results.size(), polys.size());
+  for(size_t i = 0; i < results.size(); i++) {
+    BOOST_CHECK_EQUAL(results[i].size(), i % 2 ? 2 : 3);
+    G2Poly product = G2Poly::Xn(0);
+    for(auto it = results[i].begin(); it != results[i].end(); it++) {
+      for(uint64_t j = 0; j < it->second; j++) {
+        product *= it->first;
+      }
+    }
+    BOOST_CHECK_EQUAL(product, polys[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_mul )
+{
+  ThreadPool pool(4);
+  auto a = G2Poly::Rand(500);
+  auto b = G2Poly::Rand(400);
+
+  BOOST_CHECK_EQUAL(parallelMul(a, b, pool), a * b);
+  BOOST_CHECK_EQUAL(parallelMul(b, a, pool), a * b);
+
+  // Unbalanced operands, and halves which are null
+  auto c = G2Poly::Rand(700);
+  auto d = G2Poly::Rand(300);
+  auto e = G2Poly::Xn(400) * G2Poly::Rand(100);
+  BOOST_CHECK_EQUAL(parallelMul(c, d, pool), c * d);
+  BOOST_CHECK_EQUAL(parallelMul(d, c, pool), c * d);
+  BOOST_CHECK_EQUAL(parallelMul(e, a, pool), e * a);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_distinct_degree_factors_on_nintendo_1 )
+{
+  ThreadPool pool(4);
+  // 73AF = 111001110101111 
+  G2Poly a({1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1});
+  G2Poly unit({1});
+
+  auto result = a.distinctDegreeFactors(2, pool);
+
+  BOOST_CHECK_EQUAL(result.size(), 14);
+  for(int i = 0; i < 6; i++) {
+    BOOST_CHECK_EQUAL(result[i], unit);
+  }
+  BOOST_CHECK_EQUAL(result[6], a);
+  for(int i = 7; i < 14; i++) {
+    BOOST_CHECK(result[i].null());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_distinct_degree_factors )
+{
+  ThreadPool pool(4);
+  for(int k = 0; k < 10; k++) {
+    auto a = G2Poly::Rand(300);
+    auto result = a.distinctDegreeFactors(2, pool);
+    G2Poly product = G2Poly::Xn(0);
+    for(size_t i = 0; i < result.size(); i++) {
+      if(!result[i].null()) {
+        product *= result[i];
+        // Factors of degree i+1 divide X^(2^(i+1)) - X, and no X^(2^(j+1)) - X
+        // for a proper divisor j+1 of i+1
+        auto x = G2Poly::Xn(1) % result[i];
+        auto h = x;
+        for(size_t j = 0; j <= i; j++) {
+          h = (h*h) % result[i];
+          if(result[i].degree() > 0 && j < i && (i+1) % (j+1) == 0) {
+            BOOST_CHECK(h != x && gcd(result[i], h - x) == G2Poly::Xn(0));
+          }
+        }
+        BOOST_CHECK_EQUAL(h, x);
+      }
+    }
+    BOOST_CHECK_EQUAL(product, a.squareFreePart(2));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_rand_seeded )
+{
+  RandomGenerator r1(42), r2(42);
+  for(uint64_t n = 0; n < 200; n += 13) {
+    auto a = G2Poly::Rand(n, r1);
+    BOOST_CHECK(a.degree() < static_cast<int64_t>(n));
+    BOOST_CHECK_EQUAL(a, G2Poly::Rand(n, r2));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_equal_degree_factorize_is_seeded )
+{
+  // Same seed, different schedulings: same factor
+  ThreadPool pool1(1), pool4(4);
+  // 73AF = 111001110101111 
+  G2Poly a({1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1});
+  std::vector<G2Poly> results;
+  for(int run = 0; run < 4; run++) {
+    RandomGenerator rng(1234);
+    RandomGeneratorGuard guard(rng);
+    results.push_back(a.equalDegreeFactorize(2, 7, run % 2 ? pool4 : pool1, 3));
+  }
+  for(int run = 1; run < 4; run++) {
+    BOOST_CHECK_EQUAL(results[run], results[0]);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
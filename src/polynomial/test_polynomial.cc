@@ -1,7 +1,14 @@
 #define BOOST_TEST_MODULE TestPolynomial
 #include <boost/test/included/unit_test.hpp>
 #include "polynomial.h"
+#include "polynomial_ff.h"
+#include "polynomial_multimodular.h"
+#include "polynomial_berlekamp.h"
 #include "../finite_fields/finite_fields.h"
+#include "../finite_fields/finite_fields_montgomery.h"
+#include "../finite_fields/finite_fields_runtime.h"
+#include "../finite_fields/finite_fields_extension.h"
+#include "../finite_fields/finite_fields_log.h"
 #include <sstream>
 #include <boost/rational.hpp>
 #include <boost/multiprecision/gmp.hpp>
@@ -9,6 +16,7 @@
 #include <algorithm>
 #include <utility>
 #include <cstdlib>
+#include <atomic>
 
 struct PolynomialFixture
 {
@@ -449,4 +457,959 @@ BOOST_AUTO_TEST_CASE( test_distinct_degree_factors )
   BOOST_CHECK_EQUAL(result[5], nullPoly);
 }
 
+BOOST_AUTO_TEST_CASE( test_distinct_degree_factors_montgomery ) 
+{
+  typedef MontFFElem<5> F;
+  Poly<F> f1({F(1), F(1)});
+  Poly<F> f2({F(2), F(1)});
+  Poly<F> f3({F(1), F(1), F(1)});
+  Poly<F> f4({F(2), F(1), F(1)});
+
+  Poly<F> f = f1*f2*f3*f4;
+  Poly<F> g1({F(2), F(3), F(1)});
+  Poly<F> g2({F(2), F(3), F(4), F(2), F(1)});
+
+  auto result = f.distinctDegreeFactors(5);
+
+  BOOST_CHECK_EQUAL(result.size(), 6);
+  BOOST_CHECK_EQUAL(result[0], g1);
+  BOOST_CHECK_EQUAL(result[1], g2);
+}
+
+BOOST_AUTO_TEST_CASE( test_distinct_degree_factors_log_tables ) 
+{
+  typedef LogFFElem<5> F;
+  Poly<F> f1({F(1), F(1)});
+  Poly<F> f2({F(2), F(1)});
+  Poly<F> f3({F(1), F(1), F(1)});
+  Poly<F> f4({F(2), F(1), F(1)});
+
+  Poly<F> f = f1*f2*f3*f4;
+  Poly<F> g1({F(2), F(3), F(1)});
+  Poly<F> g2({F(2), F(3), F(4), F(2), F(1)});
+
+  auto result = f.distinctDegreeFactors(5);
+
+  BOOST_CHECK_EQUAL(result.size(), 6);
+  BOOST_CHECK_EQUAL(result[0], g1);
+  BOOST_CHECK_EQUAL(result[1], g2);
+}
+
+BOOST_AUTO_TEST_CASE( test_distinct_degree_factors_runtime_modulus ) 
+{
+  FFContextGuard guard(std::make_shared<FFContext>(5));
+  typedef DynFFElem F;
+  Poly<F> f1({F(1), F(1)});
+  Poly<F> f2({F(2), F(1)});
+  Poly<F> f3({F(1), F(1), F(1)});
+  Poly<F> f4({F(2), F(1), F(1)});
+
+  Poly<F> f = f1*f2*f3*f4;
+  Poly<F> g1({F(2), F(3), F(1)});
+  Poly<F> g2({F(2), F(3), F(4), F(2), F(1)});
+
+  auto result = f.distinctDegreeFactors(5);
+
+  BOOST_CHECK_EQUAL(result.size(), 6);
+  BOOST_CHECK_EQUAL(result[0], g1);
+  BOOST_CHECK_EQUAL(result[1], g2);
+}
+
+BOOST_AUTO_TEST_CASE( test_factors_over_extension_field ) 
+{
+  // X^2 + X + 1 is irreducible over GF(2) but splits over GF(4) = GF(2)[a] / (a^2 + a + 1)
+  typedef ExtFFElem<2, 2> F;
+  ExtFFContextGuard<2, 2> guard(std::make_shared<ExtFFContext<2, 2>>(Poly<FFElem<2>>({1, 1, 1})));
+  F a = F::generator();
+  Poly<F> f({1, 1, 1});
+  Poly<F> g1({a, 1});
+  Poly<F> g2({a+F(1), 1});
+
+  BOOST_CHECK_EQUAL(g1*g2, f);
+  BOOST_CHECK_EQUAL(gcd(f, g1*g1), g1);
+  BOOST_CHECK((f % g2).null());
+}
+
+BOOST_AUTO_TEST_CASE( test_large_product_over_prime_field ) 
+{
+  typedef FFElem<998244353> F;
+  Poly<F> a = Poly<F>::Rand(300);
+  Poly<F> b = Poly<F>::Rand(200);
+  Poly<F> c = Poly<F>::Rand(250);
+  Poly<F> three({3});
+
+  BOOST_CHECK_EQUAL((a+b)*c, a*c + b*c);
+  BOOST_CHECK_EQUAL((a-b)*c, a*c - b*c);
+  BOOST_CHECK((three*a - a - a - a).null());
+  BOOST_CHECK_EQUAL(F(5)*(a*c), (F(5)*a)*c);
+}
+
+template <uint64_t n>
+void checkLazySchoolbook() {
+  typedef FFElem<n> F;
+  std::vector<F> a, b;
+  for(int i = 0; i < 300; i++) {
+    a.push_back(F(-1-i));
+    b.push_back(F(uint64_t(rand()) * rand()));
+  }
+  std::vector<F> lazy(599, F(1));
+  std::vector<F> reference(599, F(1));
+
+  coeffsMulSchoolbook(PolyKernel(), lazy.data(), a.data(), a.size(), b.data(), b.size());
+  coeffsMulSchoolbook<F>(PolyKernel(), reference.data(), a.data(), a.size(), b.data(), b.size());
+
+  BOOST_CHECK(lazy == reference);
+}
+
+BOOST_AUTO_TEST_CASE( test_lazy_reduction_schoolbook_product ) 
+{
+  checkLazySchoolbook<2>();
+  checkLazySchoolbook<5>();
+  checkLazySchoolbook<65521>();
+  // Several reductions per coefficient
+  checkLazySchoolbook<268435399>();
+  checkLazySchoolbook<2147483647>();
+  checkLazySchoolbook<2305843009213693951>();
+}
+
+BOOST_AUTO_TEST_CASE( test_make_monic ) 
+{
+  typedef FFElem<65521> F;
+  std::vector<Poly<F>> polys = {Poly<F>({1, 2, 3}), Poly<F>(), Poly<F>({5, 7}), Poly<F>({4})};
+  makeMonic(polys);
+
+  BOOST_CHECK_EQUAL(polys[0], Poly<F>({1, 2, 3}) / F(3));
+  BOOST_CHECK(polys[1].null());
+  BOOST_CHECK_EQUAL(polys[2], Poly<F>({5, 7}) / F(7));
+  BOOST_CHECK_EQUAL(polys[3], Poly<F>::Xn(0));
+
+  std::vector<Poly<double>> reals = {Poly<double>({1, 4})};
+  makeMonic(reals);
+  BOOST_CHECK_EQUAL(reals[0], Poly<double>({0.25, 1}));
+}
+
+template <typename T>
+void checkKaratsuba(size_t na, size_t nb) {
+  std::vector<T> a, b;
+  for(size_t i = 0; i < na; i++) {
+    a.push_back(T(rand() % 2001 - 1000));
+  }
+  for(size_t i = 0; i < nb; i++) {
+    b.push_back(T(rand() % 2001 - 1000));
+  }
+  std::vector<T> karatsuba(na+nb-1, T(3));
+  std::vector<T> schoolbook(na+nb-1, T(3));
+
+  coeffsMul(PolyKernel(), karatsuba.data(), a.data(), na, b.data(), nb);
+  coeffsMulSchoolbook(PolyKernel(), schoolbook.data(), a.data(), na, b.data(), nb);
+
+  BOOST_CHECK(karatsuba == schoolbook);
+}
+
+BOOST_AUTO_TEST_CASE( test_karatsuba_product ) 
+{
+  checkKaratsuba<long long>(200, 200);
+  // Odd lengths, unbalanced operands
+  checkKaratsuba<long long>(257, 131);
+  checkKaratsuba<long long>(70, 500);
+  checkKaratsuba<FFElem<998244353>>(300, 300);
+  checkKaratsuba<int512_t>(150, 97);
+}
+
+BOOST_AUTO_TEST_CASE( test_karatsuba_poly_product ) 
+{
+  Poly<int> a = Poly<int>::Xn(300) + Poly<int>({1, -1});
+  Poly<int> b = Poly<int>::Xn(200) - Poly<int>({1, 1});
+  Poly<int> expected = Poly<int>::Xn(500) - Poly<int>::Xn(301) - Poly<int>::Xn(300) - Poly<int>::Xn(201) + Poly<int>::Xn(200) + Poly<int>({-1, 0, 1});
+
+  BOOST_CHECK_EQUAL(a*b, expected);
+}
+
+template <uint64_t n>
+void checkNTT(size_t na, size_t nb) {
+  typedef FFElem<n> F;
+  std::vector<F> a, b;
+  for(size_t i = 0; i < na; i++) {
+    a.push_back(F(uint64_t(rand()) * rand()));
+  }
+  for(size_t i = 0; i < nb; i++) {
+    b.push_back(F(uint64_t(rand()) * rand()));
+  }
+  std::vector<F> ntt(na+nb-1, F(3));
+  std::vector<F> schoolbook(na+nb-1, F(3));
+
+  coeffsMul(PolyKernel(), ntt.data(), a.data(), na, b.data(), nb);
+  coeffsMulSchoolbook<F>(PolyKernel(), schoolbook.data(), a.data(), na, b.data(), nb);
+
+  BOOST_CHECK(ntt == schoolbook);
+}
+
+BOOST_AUTO_TEST_CASE( test_ntt_product ) 
+{
+  // 119*2^23 + 1
+  checkNTT<998244353>(300, 300);
+  checkNTT<998244353>(1000, 257);
+  // 2^16 + 1
+  checkNTT<65537>(600, 400);
+  // 29*2^57 + 1
+  checkNTT<4179340454199820289>(300, 500);
+  // 3*2^5 + 1: too few roots of unity, falls back to Karatsuba
+  checkNTT<97>(300, 300);
+}
+
+BOOST_AUTO_TEST_CASE( test_ntt_square ) 
+{
+  typedef FFElem<998244353> F;
+  Poly<F> a = Poly<F>::Rand(1000);
+  Poly<F> b = a;
+
+  BOOST_CHECK_EQUAL(a*a, a*b);
+  BOOST_CHECK_EQUAL((a*a) % a, Poly<F>());
+}
+
+void checkFFTInt64(size_t na, size_t nb, int64_t bound) {
+  std::vector<int64_t> a, b;
+  for(size_t i = 0; i < na; i++) {
+    a.push_back((int64_t(rand()) * rand()) % bound);
+  }
+  for(size_t i = 0; i < nb; i++) {
+    b.push_back(-(int64_t(rand()) * rand()) % bound);
+  }
+  std::vector<int64_t> fft(na+nb-1, 3);
+  std::vector<int64_t> schoolbook(na+nb-1, 3);
+
+  coeffsMul(PolyKernel(), fft.data(), a.data(), na, b.data(), nb);
+  coeffsMulSchoolbook(PolyKernel(), schoolbook.data(), a.data(), na, b.data(), nb);
+
+  BOOST_CHECK(fft == schoolbook);
+}
+
+BOOST_AUTO_TEST_CASE( test_fft_product_int64 ) 
+{
+  checkFFTInt64(300, 300, 1000);
+  checkFFTInt64(1000, 700, 1 << 20);
+  // Needs coefficients to be split in halves
+  checkFFTInt64(1000, 1000, int64_t(1) << 26);
+  // Can't be certified: falls back to Karatsuba
+  checkFFTInt64(300, 300, int64_t(1) << 40);
+}
+
+BOOST_AUTO_TEST_CASE( test_fft_product_double ) 
+{
+  std::vector<double> a, b;
+  for(size_t i = 0; i < 500; i++) {
+    a.push_back(rand() / double(RAND_MAX) - 0.5);
+    b.push_back(rand() / double(RAND_MAX) - 0.5);
+  }
+  std::vector<double> fft(999), schoolbook(999);
+
+  coeffsMul(PolyKernel(), fft.data(), a.data(), a.size(), b.data(), b.size());
+  coeffsMulSchoolbook(PolyKernel(), schoolbook.data(), a.data(), a.size(), b.data(), b.size());
+
+  for(size_t i = 0; i < fft.size(); i++) {
+    BOOST_CHECK_SMALL(fft[i] - schoolbook[i], 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_fft_poly_product_int64 ) 
+{
+  Poly<int64_t> a = Poly<int64_t>::Xn(400) - Poly<int64_t>::Xn(0);
+  Poly<int64_t> b = Poly<int64_t>::Xn(400) + Poly<int64_t>::Xn(0);
+
+  BOOST_CHECK_EQUAL(a*b, Poly<int64_t>::Xn(800) - Poly<int64_t>::Xn(0));
+}
+
+template <typename T>
+void checkMultiModular(size_t na, size_t nb, int words) {
+  std::vector<T> a(na), b(nb);
+  for(size_t i = 0; i < na; i++) {
+    for(int w = 0; w < words; w++) {
+      a[i] = a[i] * RAND_MAX + rand();
+    }
+  }
+  for(size_t i = 0; i < nb; i++) {
+    for(int w = 0; w < words; w++) {
+      b[i] = b[i] * RAND_MAX - rand();
+    }
+  }
+  std::vector<T> multiModular(na+nb-1, T(3));
+  std::vector<T> schoolbook(na+nb-1, T(3));
+
+  coeffsMul(PolyKernel(), multiModular.data(), a.data(), na, b.data(), nb);
+  coeffsMulSchoolbook(PolyKernel(), schoolbook.data(), a.data(), na, b.data(), nb);
+
+  BOOST_CHECK(multiModular == schoolbook);
+}
+
+BOOST_AUTO_TEST_CASE( test_multimodular_product ) 
+{
+  checkMultiModular<mpint>(100, 100, 1);
+  checkMultiModular<mpint>(300, 150, 10);
+  // Too large for the primes available: falls back to Karatsuba
+  checkMultiModular<mpint>(100, 100, 20);
+  checkMultiModular<int512_t>(200, 100, 5);
+  checkMultiModular<int512_t>(100, 100, 8);
+
+  // 2^20 coefficients: the most the primes all have an NTT for
+  std::vector<mpint> a((1 << 19) + 1, mpint(1)), b(1 << 19, mpint(1)), r(1 << 20);
+  BOOST_CHECK(multiModularMul(r.data(), a.data(), a.size(), b.data(), b.size()));
+  for(size_t i = 0; i < r.size(); i += 4099) {
+    BOOST_CHECK_EQUAL(r[i], mpint(std::min(std::min(i+1, r.size()-i), b.size())));
+  }
+  a.push_back(mpint(1));
+  r.push_back(mpint(0));
+  BOOST_CHECK(!multiModularMul(r.data(), a.data(), a.size(), b.data(), b.size()));
+}
+
+BOOST_AUTO_TEST_CASE( test_multimodular_product_rational ) 
+{
+  std::vector<boost::rational<mpint>> a, b;
+  std::vector<boost::rational<int64_t>> c, d;
+  for(int i = 0; i < 100; i++) {
+    a.push_back(boost::rational<mpint>(rand() - RAND_MAX/2, rand() % 1000 + 1));
+    b.push_back(boost::rational<mpint>(rand(), rand() % 1000 + 1));
+    c.push_back(boost::rational<int64_t>(i - 30, i % 7 + 1));
+    d.push_back(boost::rational<int64_t>(i % 11 + 1, i % 5 + 2));
+  }
+  std::vector<boost::rational<mpint>> multiModular(199), schoolbook(199);
+  coeffsMul(PolyKernel(), multiModular.data(), a.data(), a.size(), b.data(), b.size());
+  coeffsMulSchoolbook(PolyKernel(), schoolbook.data(), a.data(), a.size(), b.data(), b.size());
+  BOOST_CHECK(multiModular == schoolbook);
+
+  Poly<boost::rational<int64_t>> p(c), q(d), expected;
+  expected.coeffs_.resize(199);
+  coeffsMulSchoolbook(PolyKernel(), expected.coeffs_.data(), c.data(), c.size(), d.data(), d.size());
+  expected.simplify();
+  BOOST_CHECK_EQUAL(p*q, expected);
+}
+
+BOOST_AUTO_TEST_CASE( test_series_inverse ) 
+{
+  // 1 / (1 - X) = 1 + X + X^2 + ...
+  std::vector<int> f = {1, -1};
+  std::vector<int> g = seriesInverse(f, 10);
+
+  BOOST_CHECK(g == std::vector<int>(10, 1));
+}
+
+template <typename T>
+void checkNewtonDivision(int na, int nb) {
+  Poly<T> a = Poly<T>::Rand(na);
+  Poly<T> b = Poly<T>::Rand(nb);
+  auto qr = euclidDivide(a, b);
+
+  BOOST_CHECK(qr.second.degree() < b.degree());
+  BOOST_CHECK_EQUAL(qr.first * b + qr.second, a);
+}
+
+BOOST_AUTO_TEST_CASE( test_newton_division ) 
+{
+  checkNewtonDivision<FFElem<998244353>>(2000, 1000);
+  checkNewtonDivision<FFElem<998244353>>(3000, 600);
+  checkNewtonDivision<FFElem<65521>>(700, 10);
+}
+
+BOOST_AUTO_TEST_CASE( test_newton_division_matches_classical ) 
+{
+  typedef FFElem<65521> F;
+  Poly<F> a = Poly<F>::Rand(300);
+  Poly<F> b = Poly<F>::Rand(100);
+  // Below the cutoff: classical division
+  auto classical = euclidDivide(a, b);
+  auto newton = newtonDivide(a, b);
+
+  BOOST_CHECK_EQUAL(newton.first, classical.first);
+  BOOST_CHECK_EQUAL(newton.second, classical.second);
+}
+
+BOOST_AUTO_TEST_CASE( test_newton_division_rational ) 
+{
+  Poly<boost::rational<mpint>> a, b;
+  for(int i = 0; i < 40; i++) {
+    a.coeffs_.push_back(boost::rational<mpint>(rand() % 100, rand() % 10 + 1));
+  }
+  for(int i = 0; i < 20; i++) {
+    b.coeffs_.push_back(boost::rational<mpint>(rand() % 100, rand() % 10 + 1));
+  }
+  b.coeffs_.push_back(boost::rational<mpint>(3));
+  a.simplify();
+  auto classical = euclidDivide(a, b);
+  auto newton = newtonDivide(a, b);
+
+  BOOST_CHECK_EQUAL(newton.first, classical.first);
+  BOOST_CHECK_EQUAL(newton.second, classical.second);
+}
+
+template <typename T>
+Poly<T> classicalGcd(Poly<T> a, Poly<T> b) {
+  while(!b.null()) {
+    Poly<T> r = a % b;
+    a = b;
+    b = r;
+  }
+  return a / a.coeffs_[a.degree()];
+}
+
+template <typename T>
+void checkHalfGcd(int na, int nb, int ng) {
+  Poly<T> g = Poly<T>::Rand(ng);
+  Poly<T> a = Poly<T>::Rand(na) * g;
+  Poly<T> b = Poly<T>::Rand(nb) * g;
+  Poly<T> u, v;
+  Poly<T> d = extendedGcd(a, b, u, v);
+
+  BOOST_CHECK_EQUAL(gcd(a, b), classicalGcd(a, b));
+  BOOST_CHECK_EQUAL(d, classicalGcd(a, b));
+  BOOST_CHECK_EQUAL(u*a + v*b, d);
+  BOOST_CHECK(u.degree() < b.degree() && v.degree() < a.degree());
+}
+
+BOOST_AUTO_TEST_CASE( test_half_gcd ) 
+{
+  checkHalfGcd<FFElem<998244353>>(2000, 1500, 700);
+  checkHalfGcd<FFElem<998244353>>(1500, 1500, 10);
+  checkHalfGcd<FFElem<65521>>(300, 200, 100);
+  checkHalfGcd<FFElem<2>>(3000, 2000, 20);
+}
+
+BOOST_AUTO_TEST_CASE( test_extended_gcd ) 
+{
+  typedef boost::rational<int> Q;
+  // a = (X - 1)^2 (X + 1)^2, b = 4X (X - 1)(X + 1)
+  Poly<Q> a({1, 0, -2, 0, 1});
+  Poly<Q> b = a.derivate();
+  Poly<Q> u, v;
+  Poly<Q> g = extendedGcd(a, b, u, v);
+
+  BOOST_CHECK_EQUAL(g, Poly<Q>({-1, 0, 1}));
+  BOOST_CHECK_EQUAL(u*a + v*b, g);
+  // gcd(a, 0) = a / lead(a)
+  BOOST_CHECK_EQUAL(extendedGcd(b, Poly<Q>(), u, v), Poly<Q>({0, -1, 0, 1}));
+  BOOST_CHECK_EQUAL(u, Poly<Q>({Q(1, 4)}));
+  BOOST_CHECK(v.null());
+  BOOST_CHECK_EQUAL(gcd(Poly<Q>(), b), Poly<Q>({0, -1, 0, 1}));
+}
+
+Poly<mpint> randomIntegerPoly(int n, int words) {
+  Poly<mpint> p;
+  for(int i = 0; i < n; i++) {
+    mpint c = rand() % 2 ? 1 : -1;
+    for(int j = 0; j < words; j++) {
+      c = (c << 31) + rand();
+    }
+    p.coeffs_.push_back(c);
+  }
+  p.coeffs_.push_back(1);
+  return p;
+}
+
+BOOST_AUTO_TEST_CASE( test_modular_gcd ) 
+{
+  Poly<mpint> g = randomIntegerPoly(20, 3);
+  Poly<mpint> a = mpint(6) * (g * randomIntegerPoly(30, 2));
+  Poly<mpint> b = mpint(-4) * (g * randomIntegerPoly(25, 4));
+
+  BOOST_CHECK_EQUAL(gcd(a, b), mpint(2) * g);
+  BOOST_CHECK_EQUAL(gcd(a, Poly<mpint>()), a);
+  BOOST_CHECK_EQUAL(gcd(Poly<mpint>(), b), Poly<mpint>() - b);
+}
+
+BOOST_AUTO_TEST_CASE( test_modular_gcd_rational ) 
+{
+  typedef boost::rational<mpint> Q;
+  Poly<Q> g, f1, f2;
+  for(int i = 0; i < 30; i++) {
+    g.coeffs_.push_back(Q(rand() % 1000 - 500, rand() % 100 + 1));
+    f1.coeffs_.push_back(Q(rand() % 1000 - 500, rand() % 100 + 1));
+    f2.coeffs_.push_back(Q(rand() % 1000 - 500, rand() % 100 + 1));
+  }
+  g.coeffs_.push_back(Q(7, 3));
+  f1.coeffs_.push_back(Q(1));
+  f2.coeffs_.push_back(Q(-2, 5));
+  Poly<Q> a = g * f1, b = g * f2;
+
+  BOOST_CHECK_EQUAL(gcd(a, b), gcd<Q>(a, b));
+  BOOST_CHECK_EQUAL(gcd(a, b), g / g.coeffs_[g.degree()]);
+}
+
+BOOST_AUTO_TEST_CASE( test_modular_gcd_unlucky_primes ) 
+{
+  // The first prime divides the leading coefficient of a, and a/g and b/g have
+  // a common root modulo the second one, giving an image of too high a degree.
+  uint64_t p0 = multiModularPrimes[0], p1 = multiModularPrimes[1];
+  Poly<mpint> g({-3, 0, 5});
+  Poly<mpint> a = g * Poly<mpint>({1, mpint(p0)});
+  Poly<mpint> b = g * Poly<mpint>({mpint(multiModularInverse(p0, p1)), 1});
+
+  BOOST_CHECK_EQUAL(gcd(a, b), g);
+}
+
+BOOST_AUTO_TEST_CASE( test_modular_gcd_large_coefficients ) 
+{
+  // Coefficients of the gcd too large for the primes: the gcd is computed over Q
+  Poly<mpint> g({(mpint(1) << 1200) + 1, 3});
+  Poly<mpint> a = g * Poly<mpint>({-1, 1});
+  Poly<mpint> b = g * Poly<mpint>({2, 1});
+
+  BOOST_CHECK_EQUAL(gcd(a, b), g);
+}
+
+BOOST_AUTO_TEST_CASE( test_poly_modulus ) 
+{
+  typedef FFElem<998244353> F;
+  Poly<F> f = Poly<F>::Rand(700);
+  Poly<F> a = Poly<F>::Rand(700);
+  Poly<F> b = Poly<F>::Rand(600);
+  PolyModulus<F> ctx(f);
+
+  BOOST_CHECK_EQUAL(ctx.reduce(a*b), (a*b) % f);
+  BOOST_CHECK_EQUAL(ctx.mulMod(a % f, b), (a*b) % f);
+  BOOST_CHECK_EQUAL(ctx.reduce(b), b);
+  BOOST_CHECK_EQUAL(powmod(b, 5, ctx), b.power(5) % f);
+}
+
+BOOST_AUTO_TEST_CASE( test_powmod_big_exponent ) 
+{
+  typedef FFElem<998244353> F;
+  // 3 is not a square mod 998244353: X^2 - 3 is irreducible, so that X^(p^2) = X
+  Poly<F> f({F(-3), F(0), F(1)});
+  PolyModulus<F> ctx(f);
+  mpint p = 998244353;
+
+  BOOST_CHECK_EQUAL(powmod(Poly<F>::Xn(1), mpint(p*p), ctx), Poly<F>::Xn(1));
+  BOOST_CHECK_EQUAL(powmod(Poly<F>::Xn(1), p, ctx), Poly<F>({F(0), F(-1)}));
+  BOOST_CHECK_EQUAL(powmod(Poly<F>::Xn(3), 0, ctx), Poly<F>::Xn(0));
+}
+
+BOOST_AUTO_TEST_CASE( test_distinct_degree_factors_large_prime ) 
+{
+  typedef FFElem<998244353> F;
+  Poly<F> linear = Poly<F>({F(-1), F(1)}) * Poly<F>({F(-2), F(1)});
+  Poly<F> quadratic({F(-3), F(0), F(1)});
+  auto result = (linear * quadratic).distinctDegreeFactors(998244353);
+
+  BOOST_CHECK_EQUAL(result.size(), 4);
+  BOOST_CHECK_EQUAL(result[0], linear);
+  BOOST_CHECK_EQUAL(result[1], quadratic);
+  BOOST_CHECK(result[2].null());
+  BOOST_CHECK(result[3].null());
+}
+
+BOOST_AUTO_TEST_CASE( test_equal_degree_factorize ) 
+{
+  typedef FFElem<101> F;
+  Poly<F> f = Poly<F>::Xn(0);
+  for(int i = 0; i < 20; i++) {
+    f = f * Poly<F>({F(-i), F(1)});
+  }
+  auto g = f.equalDegreeFactorize(101, 1);
+
+  BOOST_CHECK(g.degree() > 0 && g.degree() < f.degree());
+  BOOST_CHECK((f % g).null());
+
+  // X^2 + X + 2 and X^2 + 1 over GF(3)
+  typedef FFElem<3> G;
+  Poly<G> q1({G(2), G(1), G(1)}), q2({G(1), G(0), G(1)});
+  auto h = (q1 * q2).equalDegreeFactorize(3, 2);
+
+  BOOST_CHECK(h == q1 || h == q2);
+
+  // X^3 + X + 1 and X^3 + X^2 + 1 over GF(2)
+  typedef FFElem<2> H;
+  Poly<H> c1({H(1), H(1), H(0), H(1)}), c2({H(1), H(0), H(1), H(1)});
+  auto c = (c1 * c2).equalDegreeFactorize(2, 3);
+
+  BOOST_CHECK(c == c1 || c == c2);
+}
+
+BOOST_AUTO_TEST_CASE( test_thread_pool ) 
+{
+  ThreadPool pool(4);
+  std::atomic<int> count(0);
+  TaskGroup group(pool);
+  // Tasks waiting for groups of their own
+  for(int i = 0; i < 8; i++) {
+    group.run([&]() {
+      TaskGroup inner(pool);
+      for(int j = 0; j < 100; j++) {
+        inner.run([&]() { count++; });
+      }
+      inner.wait();
+    });
+  }
+  group.wait();
+
+  BOOST_CHECK_EQUAL(count.load(), 800);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_equal_degree_factorize ) 
+{
+  ThreadPool pool(4);
+  typedef FFElem<101> F;
+  Poly<F> f = Poly<F>::Xn(0);
+  for(int i = 0; i < 20; i++) {
+    f = f * Poly<F>({F(-i), F(1)});
+  }
+  auto g = f.equalDegreeFactorize(101, 1, pool);
+
+  BOOST_CHECK(g.degree() > 0 && g.degree() < f.degree());
+  BOOST_CHECK((f % g).null());
+
+  // X^2 + X + 2 and X^2 + 1 over GF(3), more trials than workers
+  typedef FFElem<3> G;
+  Poly<G> q1({G(2), G(1), G(1)}), q2({G(1), G(0), G(1)});
+  auto h = (q1 * q2).equalDegreeFactorize(3, 2, pool, 16);
+
+  BOOST_CHECK(h == q1 || h == q2);
+
+  // X^3 + X + 1 and X^3 + X^2 + 1 over GF(2)
+  typedef FFElem<2> H;
+  Poly<H> c1({H(1), H(1), H(0), H(1)}), c2({H(1), H(0), H(1), H(1)});
+  auto c = (c1 * c2).equalDegreeFactorize(2, 3, pool);
+
+  BOOST_CHECK(c == c1 || c == c2);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_equal_degree_factorize_runtime_modulus ) 
+{
+  // The pool tasks get the field context of the calling thread
+  ThreadPool pool(2);
+  FFContextGuard guard(std::make_shared<FFContext>(65521));
+  typedef DynFFElem F;
+  Poly<F> f = Poly<F>::Xn(0);
+  for(int i = 0; i < 40; i++) {
+    f = f * Poly<F>({F(-i), F(1)});
+  }
+  for(int run = 0; run < 10; run++) {
+    auto g = f.equalDegreeFactorize(65521, 1, pool, 8);
+
+    BOOST_CHECK(g.degree() > 0 && g.degree() < f.degree());
+    BOOST_CHECK((f % g).null());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_compose_mod ) 
+{
+  typedef FFElem<65521> F;
+  Poly<F> f = Poly<F>::Rand(100);
+  Poly<F> g = Poly<F>::Rand(99);
+  Poly<F> h = Poly<F>::Rand(99);
+  PolyModulus<F> ctx(f);
+  // Horner's rule
+  Poly<F> expected;
+  for(int i = g.degree(); i >= 0; i--) {
+    expected = ctx.mulMod(expected, h) + Poly<F>({g.coeffs_[i]});
+  }
+
+  BOOST_CHECK_EQUAL(composeMod(g, powersMod(h, 10, ctx), ctx), expected);
+  BOOST_CHECK_EQUAL(composeMod(g, powersMod(h, 3, ctx), ctx), expected);
+}
+
+template <typename T>
+void checkDistinctDegreeFactors(int n, int p) {
+  Poly<T> f = Poly<T>::Rand(n);
+  f = f / f.coeffs_[f.degree()];
+  auto result = f.distinctDegreeFactors(p);
+  auto product = Poly<T>::Xn(0);
+  for(size_t i = 0; i < result.size(); i++) {
+    if(result[i].null()) {
+      continue;
+    }
+    product = product * result[i];
+    BOOST_CHECK_EQUAL(result[i].degree() % (i+1), 0);
+    // The factors of degree i+1 divide X^(p^(i+1)) - X
+    PolyModulus<T> ctx(result[i]);
+    BOOST_CHECK_EQUAL(powmod(Poly<T>::Xn(1), mpint(boost::multiprecision::pow(mpint(p), i+1)), ctx), ctx.reduce(Poly<T>::Xn(1)));
+  }
+  BOOST_CHECK_EQUAL(product, f.squareFreePart(p) / f.squareFreePart(p).coeffs_[f.squareFreePart(p).degree()]);
+}
+
+BOOST_AUTO_TEST_CASE( test_distinct_degree_factors_random ) 
+{
+  checkDistinctDegreeFactors<FFElem<998244353>>(300, 998244353);
+  checkDistinctDegreeFactors<FFElem<65521>>(100, 65521);
+  checkDistinctDegreeFactors<FFElem<5>>(60, 5);
+  checkDistinctDegreeFactors<FFElem<2>>(80, 2);
+}
+
+template <uint64_t p>
+void checkBerlekamp(int n) {
+  typedef FFElem<p> T;
+  Poly<T> f = Poly<T>::Rand(n).squareFreePart(p);
+  f = f / f.coeffs_[f.degree()];
+  auto factors = berlekamp(f);
+  // As many factors as found by the distinct degree factorization
+  auto ddf = f.distinctDegreeFactors(p);
+  size_t count = 0;
+  for(size_t i = 0; i < ddf.size(); i++) {
+    if(!ddf[i].null()) {
+      count += ddf[i].degree() / (i+1);
+    }
+  }
+  BOOST_CHECK_EQUAL(factors.size(), count);
+  auto product = Poly<T>::Xn(0);
+  for(auto it = factors.begin(); it != factors.end(); it++) {
+    product = product * *it;
+    BOOST_CHECK_EQUAL(it->coeffs_[it->degree()], T(1));
+    // Irreducible: all its factors have its degree
+    auto d = it->distinctDegreeFactors(p);
+    BOOST_CHECK_EQUAL(d[it->degree()-1], *it);
+  }
+  BOOST_CHECK_EQUAL(product, f);
+}
+
+BOOST_AUTO_TEST_CASE( test_berlekamp ) 
+{
+  // (X^2 + X + 2)(X^2 + 1)X(X + 1) over GF(3)
+  typedef FFElem<3> G;
+  Poly<G> q1({G(2), G(1), G(1)}), q2({G(1), G(0), G(1)});
+  auto factors = berlekamp(q1 * q2 * Poly<G>::Xn(1) * Poly<G>({G(1), G(1)}));
+
+  BOOST_CHECK_EQUAL(factors.size(), 4);
+  BOOST_CHECK(std::find(factors.begin(), factors.end(), q1) != factors.end());
+  BOOST_CHECK(std::find(factors.begin(), factors.end(), q2) != factors.end());
+
+  // (X - 1)(X - 2) over GF(65521): 1 and 2 are both squares
+  typedef FFElem<65521> F;
+  Poly<F> l1({F(-1), F(1)}), l2({F(-2), F(1)});
+  auto linear = berlekamp(l1 * l2);
+
+  BOOST_CHECK_EQUAL(linear.size(), 2);
+  BOOST_CHECK(std::find(linear.begin(), linear.end(), l1) != linear.end());
+  BOOST_CHECK(std::find(linear.begin(), linear.end(), l2) != linear.end());
+
+  checkBerlekamp<2>(120);
+  checkBerlekamp<5>(80);
+  checkBerlekamp<101>(60);
+  checkBerlekamp<65521>(60);
+  checkBerlekamp<998244353>(40);
+}
+
+template <typename T>
+void checkFactorization(const Poly<T> &f, int p, const std::vector<std::pair<Poly<T>, int>> &factors) {
+  auto product = Poly<T>::Xn(0);
+  for(auto it = factors.begin(); it != factors.end(); it++) {
+    product = product * it->first.power(it->second);
+    BOOST_CHECK_EQUAL(it->first.coeffs_[it->first.degree()], T(1));
+    auto d = it->first.distinctDegreeFactors(p);
+    BOOST_CHECK_EQUAL(d[it->first.degree()-1], it->first);
+  }
+  BOOST_CHECK_EQUAL(product, f / f.coeffs_[f.degree()]);
+}
+
+BOOST_AUTO_TEST_CASE( test_factor ) 
+{
+  // (X + 1)(X^2 + 1)^3(X + 2)^4 over GF(3)
+  typedef FFElem<3> G;
+  Poly<G> f1({G(1), G(1)}), f2({G(1), G(0), G(1)}), f3({G(2), G(1)});
+  auto a = f1 * f2.power(3) * f3.power(4);
+  auto result = a.factor(3);
+
+  std::sort(result.begin(), result.end(), [](const std::pair<Poly<G>, int>& lhs, const std::pair<Poly<G>, int>& rhs) { return lhs.second < rhs.second; } );
+  BOOST_CHECK_EQUAL(result.size(), 3);
+  BOOST_CHECK_EQUAL(result[0].first, f1);
+  BOOST_CHECK_EQUAL(result[0].second, 1);
+  BOOST_CHECK_EQUAL(result[1].first, f2);
+  BOOST_CHECK_EQUAL(result[1].second, 3);
+  BOOST_CHECK_EQUAL(result[2].first, f3);
+  BOOST_CHECK_EQUAL(result[2].second, 4);
+
+  // (X^3 + X + 1)^2(X + 1)^5 X^4 over GF(2): the square root of the part with
+  // even multiplicities is not square free
+  typedef FFElem<2> H;
+  Poly<H> c({H(1), H(1), H(0), H(1)}), x1({H(1), H(1)});
+  auto b = c.power(2) * x1.power(5) * Poly<H>::Xn(4);
+  auto r = b.factor(2);
+
+  BOOST_CHECK_EQUAL(r.size(), 3);
+  checkFactorization(b, 2, r);
+
+  auto f = Poly<FFElem<65521>>::Rand(80);
+  checkFactorization(f, 65521, f.factor(65521));
+  auto g = Poly<FFElem<998244353>>::Rand(60) * Poly<FFElem<998244353>>::Rand(5).power(2);
+  checkFactorization(g, 998244353, g.factor(998244353));
+  auto h = Poly<FFElem<2>>::Rand(100);
+  checkFactorization(h, 2, h.factor(2));
+}
+
+BOOST_AUTO_TEST_CASE( test_factor_batch ) 
+{
+  ThreadPool pool(4);
+  typedef FFElem<65521> F;
+  std::vector<Poly<F>> polys;
+  for(int i = 0; i < 40; i++) {
+    polys.push_back(Poly<F>::Rand(10 + i) * Poly<F>::Rand(3).power(i % 3 + 1));
+  }
+  polys.push_back(Poly<F>::Xn(0));
+  auto results = factorBatch(polys, 65521, pool);
+
+  BOOST_CHECK_EQUAL(results.size(), polys.size());
+  for(int i = 0; i < 40; i++) {
+    checkFactorization(polys[i], 65521, results[i]);
+  }
+  BOOST_CHECK(results[40].empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_factor_batch_with_field_contexts ) 
+{
+  // The pool tasks get the field context of the calling thread
+  ThreadPool pool(2);
+  {
+    FFContextGuard guard(std::make_shared<FFContext>(65521));
+    typedef DynFFElem F;
+    std::vector<Poly<F>> polys;
+    for(int i = 0; i < 8; i++) {
+      polys.push_back(Poly<F>::Rand(80));
+    }
+    auto results = factorBatch(polys, 65521, pool);
+
+    for(int i = 0; i < 8; i++) {
+      checkFactorization(polys[i], 65521, results[i]);
+    }
+  }
+  {
+    // GF(9) = GF(3)[a] / (a^2 + 1)
+    typedef ExtFFElem<3, 2> F;
+    ExtFFContextGuard<3, 2> guard(std::make_shared<ExtFFContext<3, 2>>(Poly<FFElem<3>>({1, 0, 1})));
+    F a = F::generator();
+    std::vector<Poly<F>> polys;
+    for(int i = 0; i < 8; i++) {
+      // Roots i, i + a, i + 2a and i + 1
+      auto f = Poly<F>({F(i+1), 1});
+      for(int j = 0; j < 3; j++) {
+        f = f * Poly<F>({F(i) + F(j) * a, 1});
+      }
+      polys.push_back(f);
+    }
+    auto results = factorBatch(polys, 9, pool);
+
+    for(int i = 0; i < 8; i++) {
+      BOOST_CHECK_EQUAL(results[i].size(), 4);
+      auto product = Poly<F>::Xn(0);
+      for(auto it = results[i].begin(); it != results[i].end(); it++) {
+        BOOST_CHECK_EQUAL(it->first.degree(), 1);
+        product = product * it->first.power(it->second);
+      }
+      BOOST_CHECK_EQUAL(product, polys[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_mul ) 
+{
+  ThreadPool pool(4);
+  // Karatsuba steps and slices, over fields without and with NTTs
+  auto a = Poly<FFElem<65521>>::Rand(20000);
+  auto b = Poly<FFElem<65521>>::Rand(15000);
+  BOOST_CHECK_EQUAL(parallelMul(a, b, pool), a * b);
+  auto c = Poly<FFElem<998244353>>::Rand(60000);
+  auto d = Poly<FFElem<998244353>>::Rand(9000);
+  BOOST_CHECK_EQUAL(parallelMul(c, d, pool), c * d);
+  BOOST_CHECK_EQUAL(parallelMul(d, c, pool), c * d);
+  auto e = Poly<int64_t>({3, -1, 4, 1, -5});
+  BOOST_CHECK_EQUAL(parallelMul(e, e, pool), e * e);
+  BOOST_CHECK(parallelMul(Poly<int64_t>(), e, pool).null());
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_mul_runtime_modulus ) 
+{
+  // The pool tasks get the field context of the calling thread
+  ThreadPool pool(2);
+  FFContextGuard guard(std::make_shared<FFContext>(65521));
+  auto a = Poly<DynFFElem>::Rand(12000);
+  auto b = Poly<DynFFElem>::Rand(9000);
+  BOOST_CHECK_EQUAL(parallelMul(a, b, pool), a * b);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_distinct_degree_factors ) 
+{
+  ThreadPool pool(4);
+  auto f = Poly<FFElem<998244353>>::Rand(300);
+  BOOST_CHECK(f.distinctDegreeFactors(998244353, pool) == f.distinctDegreeFactors(998244353));
+  auto g = Poly<FFElem<65521>>::Rand(150);
+  BOOST_CHECK(g.distinctDegreeFactors(65521, pool) == g.distinctDegreeFactors(65521));
+  auto h = Poly<FFElem<2>>::Rand(200);
+  BOOST_CHECK(h.distinctDegreeFactors(2, pool) == h.distinctDegreeFactors(2));
+  // (X^2 + X + 2)(X^2 + 1)X(X + 1) over GF(3)
+  typedef FFElem<3> G;
+  Poly<G> q1({G(2), G(1), G(1)}), q2({G(1), G(0), G(1)}), x({G(0), G(1)}), x1({G(1), G(1)});
+  auto ddf = (q1 * q2 * x * x1).distinctDegreeFactors(3, pool);
+  BOOST_CHECK_EQUAL(ddf.size(), 6);
+  BOOST_CHECK_EQUAL(ddf[0], x * x1);
+  BOOST_CHECK_EQUAL(ddf[1], q1 * q2);
+  BOOST_CHECK(ddf[2].null());
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_distinct_degree_factors_runtime_modulus ) 
+{
+  // The pool tasks get the field context of the calling thread
+  ThreadPool pool(2);
+  FFContextGuard guard(std::make_shared<FFContext>(65521));
+  auto f = Poly<DynFFElem>::Rand(200);
+  BOOST_CHECK(f.distinctDegreeFactors(65521, pool) == f.distinctDegreeFactors(65521));
+}
+
+BOOST_AUTO_TEST_CASE( test_random_generator ) 
+{
+  RandomGenerator r1(42), r2(42), r3(43);
+  uint64_t words[8];
+  r2.fill(words, 8);
+  bool different = false;
+  for(int i = 0; i < 8; i++) {
+    BOOST_CHECK_EQUAL(r1.next(), words[i]);
+    different |= r3.next() != words[i];
+  }
+  BOOST_CHECK(different);
+  BOOST_CHECK(r1.split(0).next() != r1.split(1).next());
+
+  typedef FFElem<65521> F;
+  RandomGenerator s1(7), s2(7);
+  auto a = Poly<F>::Rand(100, s1);
+  BOOST_CHECK(a.degree() < 100);
+  BOOST_CHECK_EQUAL(a, Poly<F>::Rand(100, s2));
+  {
+    RandomGenerator s3(7);
+    RandomGeneratorGuard guard(s3);
+    BOOST_CHECK_EQUAL(&RandomGenerator::current(), &s3);
+    BOOST_CHECK_EQUAL(Poly<F>::Rand(100), a);
+  }
+  BOOST_CHECK(&RandomGenerator::current() != &s1);
+  BOOST_CHECK(Poly<double>::Rand(10, s1).degree() < 10);
+
+  // Elements of the whole of GF(9), not only of GF(3)
+  typedef ExtFFElem<3, 2> E;
+  ExtFFContextGuard<3, 2> guard(std::make_shared<ExtFFContext<3, 2>>(Poly<FFElem<3>>({1, 0, 1})));
+  auto e = Poly<E>::Rand(50, s1);
+  BOOST_CHECK(std::any_of(e.coeffs_.begin(), e.coeffs_.end(), [](const E &c) { return c.toPoly().degree() > 0; }));
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_randomized_algorithms_are_seeded ) 
+{
+  // Same seed, different schedulings: same results
+  ThreadPool pool1(1), pool4(4);
+  typedef FFElem<101> F;
+  Poly<F> f = Poly<F>::Xn(0);
+  for(int i = 0; i < 20; i++) {
+    f = f * Poly<F>({F(-i), F(1)});
+  }
+  std::vector<Poly<F>> polys;
+  RandomGenerator seed(3);
+  for(int i = 0; i < 20; i++) {
+    polys.push_back(Poly<F>::Rand(10 + i, seed));
+  }
+  std::vector<Poly<F>> factors;
+  std::vector<std::vector<std::vector<std::pair<Poly<F>, int>>>> batches;
+  for(int run = 0; run < 4; run++) {
+    RandomGenerator rng(1234);
+    RandomGeneratorGuard guard(rng);
+    ThreadPool &pool = run % 2 ? pool4 : pool1;
+    factors.push_back(f.equalDegreeFactorize(101, 1, pool, 3));
+    batches.push_back(factorBatch(polys, 101, pool));
+  }
+  for(int run = 1; run < 4; run++) {
+    BOOST_CHECK_EQUAL(factors[run], factors[0]);
+    BOOST_CHECK(batches[run] == batches[0]);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
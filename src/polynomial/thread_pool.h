@@ -0,0 +1,248 @@
+#pragma once
+
+/*
+ * Pool of worker threads running tasks, and groups of tasks to wait for.
+ *
+ * Each worker has its own queue of tasks: the tasks submitted by a worker go
+ * to its queue, from which it takes the most recent first, and idle workers
+ * steal the oldest tasks of the others. With tasks splitting their work in
+ * halves, the stolen tasks are thus the largest ones. Tasks submitted from
+ * other threads go to a shared queue.
+ *
+ * A thread waiting for a group runs pending tasks in the meantime instead of
+ * blocking, so that tasks can start groups of tasks themselves and wait for
+ * them without starving the pool.
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t threads = defaultSize());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const;
+    // Index of the calling thread among the workers, size() for other threads
+    size_t workerIndex() const;
+    void submit(std::function<void()> task);
+    // Runs a pending task in the calling thread, false if there was none
+    bool runPending();
+    // Blocks until there is a pending task or done() is true
+    void waitFor(const std::function<bool()> &done);
+    // Wakes up the threads blocked in waitFor
+    void notifyAll();
+
+    // Pool shared by default, with a worker per core
+    static ThreadPool &instance();
+    static size_t defaultSize();
+
+  protected:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    bool pop(std::function<void()> &task);
+    void work(size_t index);
+    // Pool and index of the worker running in the calling thread
+    static std::pair<const ThreadPool *, size_t> &current();
+
+    std::vector<std::thread> workers_;
+    // One queue per worker, then the shared one
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<size_t> queued_;
+    // Protects the sleeps of idle threads
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_;
+};
+
+/* Tasks run on a pool, wait() returning once all of them are done */
+class TaskGroup {
+  public:
+    explicit TaskGroup(ThreadPool &pool);
+    ~TaskGroup();
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+  protected:
+    ThreadPool &pool_;
+    std::atomic<size_t> pending_;
+};
+
+inline ThreadPool::ThreadPool(size_t threads) : queued_(0), stopping_(false) {
+  for(size_t i = 0; i <= threads; i++) {
+    queues_.emplace_back(new Queue());
+  }
+  for(size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this, i]() { work(i); });
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  available_.notify_all();
+  for(auto it = workers_.begin(); it != workers_.end(); it++) {
+    it->join();
+  }
+}
+
+inline size_t ThreadPool::size() const {
+  return queues_.size() - 1;
+}
+
+inline size_t ThreadPool::workerIndex() const {
+  auto &c = current();
+  return c.first == this ? c.second : size();
+}
+
+inline void ThreadPool::submit(std::function<void()> task) {
+  Queue &queue = *queues_[workerIndex()];
+  // Counted first so that queued_ never gets below the number of tasks
+  queued_++;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  // Taking the lock makes sure that no idle thread is between its check of
+  // queued_ and its wait
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  available_.notify_one();
+}
+
+inline bool ThreadPool::pop(std::function<void()> &task) {
+  if(queued_.load() == 0) {
+    return false;
+  }
+  size_t n = size();
+  size_t index = workerIndex();
+  // Own queue first (most recent task), then the shared one and the other
+  // workers' (oldest task)
+  for(size_t k = 0; k <= n; k++) {
+    size_t i = (index + k) % (n + 1);
+    Queue &queue = *queues_[i];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) {
+      continue;
+    }
+    if(k == 0 && index < n) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    queued_--;
+    return true;
+  }
+  return false;
+}
+
+inline bool ThreadPool::runPending() {
+  std::function<void()> task;
+  if(!pop(task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+inline void ThreadPool::waitFor(const std::function<bool()> &done) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  available_.wait(lock, [&]() { return queued_.load() > 0 || done(); });
+}
+
+inline void ThreadPool::notifyAll() {
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  available_.notify_all();
+}
+
+inline void ThreadPool::work(size_t index) {
+  current() = std::make_pair(this, index);
+  while(true) {
+    if(runPending()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+    if(stopping_ && queued_.load() == 0) {
+      return;
+    }
+  }
+}
+
+inline std::pair<const ThreadPool *, size_t> &ThreadPool::current() {
+  thread_local std::pair<const ThreadPool *, size_t> c(nullptr, 0);
+  return c;
+}
+
+inline ThreadPool &ThreadPool::instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+inline size_t ThreadPool::defaultSize() {
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+inline TaskGroup::TaskGroup(ThreadPool &pool) : pool_(pool), pending_(0) {}
+
+inline TaskGroup::~TaskGroup() {
+  wait();
+}
+
+inline void TaskGroup::run(std::function<void()> task) {
+  pending_++;
+  // The group can be destroyed as soon as pending_ reaches 0: only the pool
+  // is used after that
+  ThreadPool &pool = pool_;
+  pool_.submit([this, &pool, task]() {
+    task();
+    if(--pending_ == 0) {
+      pool.notifyAll();
+    }
+  });
+}
+
+inline void TaskGroup::wait() {
+  while(pending_.load() > 0) {
+    if(!pool_.runPending()) {
+      pool_.waitFor([this]() { return pending_.load() == 0; });
+    }
+  }
+}
+
+/*
+ * Calls body(i) for i in [begin, end) on the pool, the range being split in
+ * halves down to grain indices, so that idle workers steal large halves.
+ */
+inline void parallelFor(ThreadPool &pool, size_t begin, size_t end, size_t grain, const std::function<void(size_t)> &body) {
+  if(end - begin <= std::max(grain, size_t(1))) {
+    for(size_t i = begin; i < end; i++) {
+      body(i);
+    }
+    return;
+  }
+  size_t middle = begin + (end - begin) / 2;
+  TaskGroup group(pool);
+  group.run([&]() { parallelFor(pool, middle, end, grain, body); });
+  parallelFor(pool, begin, middle, grain, body);
+  group.wait();
+}